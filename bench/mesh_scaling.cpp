@@ -0,0 +1,203 @@
+// Simulates meshes of increasing size over InProcTransport and reports how they scale.
+// usage: vsm_mesh_scaling [--latency_ms=X] [--jitter_ms=X] [--loss=X] [--bandwidth_kbps=X]
+//                         [--seed=N] [--max_time_s=N] [--bootstrap=central|random]
+//                         [node counts ...]
+#include <vsm/inproc_transport.hpp>
+#include <vsm/mesh_node.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+
+using namespace vsm;
+
+struct ScalingResult {
+    size_t n_nodes;
+    double convergence_s;       // virtual time of the last peer selection change
+    double coverage;            // fraction of nodes reached by the probe entity
+    double latency_p50_ms;      // probe entity propagation latency
+    double latency_p99_ms;
+    double latency_max_ms;
+    double cpu_us_per_node_s;   // callback cpu time per node per virtual second
+    double tx_msgs_per_node_s;  // messages sent per node per virtual second
+    double tx_kb_per_node_s;    // kilobytes sent per node per virtual second
+    double wall_s;              // real time taken by the simulation
+};
+
+// every node bootstraps from node0, or from a random earlier node
+enum class Bootstrap { CENTRAL, RANDOM };
+
+static ScalingResult simulate(size_t n_nodes, const InProcNetwork::Config& network_config,
+        size_t max_time_s, Bootstrap bootstrap) {
+    const size_t peer_update_interval_ms = 1000;
+    const auto wall_start = std::chrono::steady_clock::now();
+    auto network = std::make_shared<InProcNetwork>(network_config);
+    std::mt19937 gen(network_config.seed);
+    // constant density of one node per unit area
+    const float side = std::sqrt(static_cast<float>(n_nodes));
+    std::uniform_real_distribution<float> position(0, side);
+
+    // record when each node first receives the probe entity
+    const int64_t never = -1;
+    std::vector<int64_t> probe_times(n_nodes, never);
+
+    std::deque<MeshNode> mesh_nodes;
+    std::vector<std::shared_ptr<InProcTransport>> transports;
+    for (size_t i = 0; i < n_nodes; ++i) {
+        std::string address = "node" + std::to_string(i);
+        transports.emplace_back(std::make_shared<InProcTransport>(network, address));
+        EgoSphere::Config ego_sphere_config;
+        ego_sphere_config.entity_update_handler =
+                [&probe_times, network, i](const EgoSphere::EntityUpdate* new_entity,
+                        const EgoSphere::EntityUpdate*, const NodeInfoT&) {
+                    if (new_entity && probe_times[i] == never) {
+                        probe_times[i] = network->getTime();
+                    }
+                    return true;
+                };
+        mesh_nodes.emplace_back(MeshNode::Config{
+                peer_update_interval_ms,  // peer update interval
+                1000,                     // entity expiry interval
+                1400,                     // entity updates size
+                false,                    // spectator
+                std::move(ego_sphere_config),  // ego sphere
+                {
+                        address,                         // name
+                        address,                         // address
+                        {position(gen), position(gen)},  // coordinates
+                },
+                transports.back(),                            // transport
+                nullptr,                                      // logger
+                [network]() { return network->getTime(); },  // local clock
+                4,                                            // buffer pool size
+        });
+        if (i > 0) {
+            auto bootstrap_id = bootstrap == Bootstrap::RANDOM ? gen() % i : 0;
+            std::string bootstrap_address = "node" + std::to_string(bootstrap_id);
+            mesh_nodes.back().getPeerTracker().latchPeer(bootstrap_address.c_str(), 1);
+        }
+    }
+
+    // run until peer selections stop changing for a few update intervals
+    std::vector<std::vector<std::string>> connected_peers(n_nodes);
+    int64_t last_change = 0;
+    for (size_t t = 0, stable = 0; t < max_time_s * 1000 && stable < 5;
+            t += peer_update_interval_ms) {
+        network->run(peer_update_interval_ms);
+        bool changed = false;
+        for (size_t i = 0; i < n_nodes; ++i) {
+            if (connected_peers[i] != mesh_nodes[i].getConnectedPeers()) {
+                connected_peers[i] = mesh_nodes[i].getConnectedPeers();
+                changed = true;
+            }
+        }
+        stable = changed ? 0 : stable + 1;
+        last_change = changed ? network->getTime() : last_change;
+    }
+    const int64_t probe_start = network->getTime();
+
+    // probe entity from the node nearest the center floods the mesh
+    size_t center = 0;
+    for (size_t i = 0; i < n_nodes; ++i) {
+        const std::vector<float> mid{side / 2, side / 2};
+        if (distanceSqr(mesh_nodes[i].getPeerTracker().getNodeInfo().coordinates, mid) <
+                distanceSqr(mesh_nodes[center].getPeerTracker().getNodeInfo().coordinates, mid)) {
+            center = i;
+        }
+    }
+    EntityT probe;
+    probe.name = "probe";
+    probe.expiry = std::numeric_limits<int64_t>::max();
+    mesh_nodes[center].updateEntities({probe});
+    network->run(10 * peer_update_interval_ms);
+
+    // collect results
+    ScalingResult result{};
+    result.n_nodes = n_nodes;
+    result.convergence_s = last_change * 1e-9;
+    std::vector<double> latencies;
+    for (auto probe_time : probe_times) {
+        if (probe_time != never) {
+            latencies.push_back((probe_time - probe_start) * 1e-6);
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.coverage = static_cast<double>(latencies.size()) / n_nodes;
+    if (!latencies.empty()) {
+        result.latency_p50_ms = latencies[latencies.size() / 2];
+        result.latency_p99_ms = latencies[latencies.size() * 99 / 100];
+        result.latency_max_ms = latencies.back();
+    }
+    InProcNetwork::Stats total;
+    for (auto& transport : transports) {
+        auto stats = transport->getStats();
+        total.tx_messages += stats.tx_messages;
+        total.tx_bytes += stats.tx_bytes;
+        total.cpu_ns += stats.cpu_ns;
+    }
+    const double node_seconds = n_nodes * network->getTime() * 1e-9;
+    result.cpu_us_per_node_s = total.cpu_ns * 1e-3 / node_seconds;
+    result.tx_msgs_per_node_s = total.tx_messages / node_seconds;
+    result.tx_kb_per_node_s = total.tx_bytes * 1e-3 / node_seconds;
+    result.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start)
+                            .count();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    InProcNetwork::Config network_config;
+    network_config.latency_ms = 5;
+    network_config.jitter_ms = 1;
+    size_t max_time_s = 120;
+    Bootstrap bootstrap = Bootstrap::CENTRAL;
+    std::vector<size_t> node_counts;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const auto option = [arg](const char* name) {
+            const size_t len = std::strlen(name);
+            return !std::strncmp(arg, name, len) && arg[len] == '=' ? arg + len + 1 : nullptr;
+        };
+        const char* value;
+        if ((value = option("--latency_ms"))) {
+            network_config.latency_ms = std::strtof(value, nullptr);
+        } else if ((value = option("--jitter_ms"))) {
+            network_config.jitter_ms = std::strtof(value, nullptr);
+        } else if ((value = option("--loss"))) {
+            network_config.loss = std::strtof(value, nullptr);
+        } else if ((value = option("--bandwidth_kbps"))) {
+            network_config.bandwidth_kbps = std::strtof(value, nullptr);
+        } else if ((value = option("--seed"))) {
+            network_config.seed = std::strtoul(value, nullptr, 10);
+        } else if ((value = option("--max_time_s"))) {
+            max_time_s = std::strtoul(value, nullptr, 10);
+        } else if ((value = option("--bootstrap"))) {
+            bootstrap = std::strcmp(value, "random") ? Bootstrap::CENTRAL : Bootstrap::RANDOM;
+        } else if (std::strtoul(arg, nullptr, 10) > 0) {
+            node_counts.push_back(std::strtoul(arg, nullptr, 10));
+        } else {
+            std::fprintf(stderr, "unknown argument %s\n", arg);
+            return 1;
+        }
+    }
+    if (node_counts.empty()) {
+        node_counts = {100, 300, 1000};
+    }
+
+    std::printf("%8s %12s %9s %12s %12s %12s %14s %12s %12s %8s\n", "nodes", "converge_s",
+            "coverage", "lat_p50_ms", "lat_p99_ms", "lat_max_ms", "cpu_us/node/s",
+            "msgs/node/s", "kB/node/s", "wall_s");
+    for (auto n_nodes : node_counts) {
+        auto r = simulate(n_nodes, network_config, max_time_s, bootstrap);
+        std::printf("%8zu %12.1f %9.3f %12.1f %12.1f %12.1f %14.1f %12.1f %12.2f %8.1f\n",
+                r.n_nodes, r.convergence_s, r.coverage, r.latency_p50_ms, r.latency_p99_ms,
+                r.latency_max_ms, r.cpu_us_per_node_s, r.tx_msgs_per_node_s, r.tx_kb_per_node_s,
+                r.wall_s);
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,371 @@
+// Microbenchmarks of the core hot paths, with optional JSON output for tracking regressions.
+// usage: vsm_bench [--json=FILE] [--filter=SUBSTRING] [--samples=N] [--min_sample_ms=N]
+#include <vsm/ego_sphere.hpp>
+#include <vsm/inproc_transport.hpp>
+#include <vsm/mesh_node.hpp>
+#include <vsm/peer_tracker.hpp>
+#include <vsm/quick_hull.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vsm;
+
+using Params = std::vector<std::pair<const char*, size_t>>;
+
+struct BenchResult {
+    std::string name;
+    Params params;
+    size_t items;       // items processed per operation
+    size_t iterations;  // operations per sample
+    std::vector<double> sample_ns;  // time per operation of each sample, sorted
+};
+
+class Bench {
+public:
+    struct Options {
+        std::string filter;
+        size_t samples = 15;
+        size_t min_sample_ms = 5;
+        FILE* table = stdout;  // human readable results
+    };
+
+    Bench(Options options)
+            : _options(std::move(options)) {}
+
+    // times op, which processes items per call, after an untimed setup per sample.
+    // without setup, iterations per sample are calibrated to take at least min_sample_ms.
+    void run(const std::string& name, Params params, size_t items, const std::function<void()>& op,
+            const std::function<void()>& setup = nullptr) {
+        if (name.find(_options.filter) == std::string::npos) {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        const auto time_ops = [&](size_t iterations) {
+            if (setup) {
+                setup();
+            }
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                op();
+            }
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        };
+        // warm up and calibrate
+        size_t iterations = 1;
+        if (!setup) {
+            const double min_sample_ns = _options.min_sample_ms * 1e6;
+            for (double ns = time_ops(1); ns < min_sample_ns; ns = time_ops(iterations)) {
+                iterations *= ns > 0 && ns * 10 > min_sample_ns ? 2 : 10;
+            }
+        } else {
+            time_ops(1);
+        }
+        BenchResult result{name, std::move(params), items, iterations, {}};
+        for (size_t i = 0; i < _options.samples; ++i) {
+            result.sample_ns.push_back(time_ops(iterations) / iterations);
+        }
+        std::sort(result.sample_ns.begin(), result.sample_ns.end());
+        printResult(result, _options.table);
+        _results.emplace_back(std::move(result));
+    }
+
+    bool writeJson(const char* path) const {
+        FILE* file = std::strcmp(path, "-") ? std::fopen(path, "w") : stdout;
+        if (!file) {
+            return false;
+        }
+        std::fprintf(file, "{\n  \"samples\": %zu,\n  \"benchmarks\": [", _options.samples);
+        for (size_t i = 0; i < _results.size(); ++i) {
+            const auto& result = _results[i];
+            std::fprintf(file, "%s\n    {\"name\": \"%s\", \"params\": {", i ? "," : "",
+                    result.name.c_str());
+            for (size_t j = 0; j < result.params.size(); ++j) {
+                std::fprintf(file, "%s\"%s\": %zu", j ? ", " : "", result.params[j].first,
+                        result.params[j].second);
+            }
+            std::fprintf(file,
+                    "}, \"items\": %zu, \"iterations\": %zu, \"ns_per_op\": {\"min\": %.1f, "
+                    "\"median\": %.1f, \"mean\": %.1f}, \"ns_per_item\": %.2f}",
+                    result.items, result.iterations, minimum(result), median(result),
+                    mean(result), median(result) / result.items);
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+        if (file != stdout) {
+            std::fclose(file);
+        }
+        return true;
+    }
+
+private:
+    // statistics are 0 when there are no samples
+    static double minimum(const BenchResult& result) {
+        return result.sample_ns.empty() ? 0 : result.sample_ns.front();
+    }
+
+    static double median(const BenchResult& result) {
+        return result.sample_ns.empty() ? 0 : result.sample_ns[result.sample_ns.size() / 2];
+    }
+
+    static double mean(const BenchResult& result) {
+        if (result.sample_ns.empty()) {
+            return 0;
+        }
+        double sum = 0;
+        for (auto ns : result.sample_ns) {
+            sum += ns;
+        }
+        return sum / result.sample_ns.size();
+    }
+
+    static void printResult(const BenchResult& result, FILE* file) {
+        std::string label = result.name;
+        for (const auto& param : result.params) {
+            label += " " + std::string(param.first) + "=" + std::to_string(param.second);
+        }
+        std::fprintf(file, "%-64s %14.1f ns/op %12.2f ns/item\n", label.c_str(), median(result),
+                median(result) / result.items);
+        std::fflush(file);
+    }
+
+    Options _options;
+    std::vector<BenchResult> _results;
+};
+
+static std::vector<float> randomCoordinates(std::mt19937& gen, size_t n_dims, float scale) {
+    std::uniform_real_distribution<float> dis(-scale, scale);
+    std::vector<float> coordinates(n_dims);
+    for (auto& coord : coordinates) {
+        coord = dis(gen);
+    }
+    return coordinates;
+}
+
+static std::vector<EntityT> makeEntities(size_t n_entities, size_t n_dims) {
+    std::mt19937 gen(0);
+    std::vector<EntityT> entities(n_entities);
+    for (size_t i = 0; i < n_entities; ++i) {
+        entities[i].name = "entity" + std::to_string(i);
+        entities[i].coordinates = randomCoordinates(gen, n_dims, 100);
+        entities[i].expiry = std::numeric_limits<int64_t>::max();
+        entities[i].data.assign(32, static_cast<uint8_t>(i));
+    }
+    return entities;
+}
+
+static MessageT makeMessage(size_t n_entities, size_t n_dims) {
+    MessageT msg;
+    msg.timestamp = 1;
+    msg.source.reset(new NodeInfoT());
+    msg.source->name = "source";
+    msg.source->address = "source";
+    msg.source->coordinates.assign(n_dims, 1);
+    for (auto& entity : makeEntities(n_entities, n_dims)) {
+        msg.entities.emplace_back(new EntityT(std::move(entity)));
+    }
+    return msg;
+}
+
+static void finishMessage(fb::FlatBufferBuilder& fbb, const MessageT& msg) {
+    fbb.Clear();
+    // timestamp is always stored so it can be mutated in place
+    fbb.ForceDefaults(true);
+    fbb.Finish(Message::Pack(fbb, &msg));
+    fbb.ForceDefaults(false);
+}
+
+static void benchEgoSphere(Bench& bench) {
+    for (size_t n_dims : {2, 3}) {
+        for (size_t n_entities : {10, 100, 1000}) {
+            Params params{{"entities", n_entities}, {"dims", n_dims}};
+            PeerTracker peer_tracker({"self", "self", std::vector<float>(n_dims, 0)});
+            fb::FlatBufferBuilder fbb;
+            finishMessage(fbb, makeMessage(n_entities, n_dims));
+            auto msg = fb::GetMutableRoot<Message>(fbb.GetBufferPointer());
+
+            // steady state updates of existing entities, each with a new timestamp
+            EgoSphere ego_sphere({});
+            std::vector<const Entity*> forward_entities;
+            int64_t timestamp = 1;
+            bench.run("ego_sphere/receive_entity_updates", params, n_entities, [&]() {
+                msg->mutate_timestamp(++timestamp);
+                ego_sphere.receiveEntityUpdates(forward_entities, msg, peer_tracker, 0);
+            });
+
+            // expire every entity, refilled before each sample
+            EgoSphere expiring({});
+            bench.run(
+                    "ego_sphere/expire_entities", params, n_entities,
+                    [&]() { expiring.expireEntities(std::numeric_limits<int64_t>::max(), {}); },
+                    [&]() {
+                        msg->mutate_timestamp(++timestamp);
+                        expiring.receiveEntityUpdates(forward_entities, msg, peer_tracker, 0);
+                    });
+        }
+    }
+    for (size_t lookup_size : {1024, 65536}) {
+        const size_t batch = 1024;
+        EgoSphere::Config config;
+        config.timestamp_lookup_size = lookup_size;
+        EgoSphere ego_sphere(config);
+        std::vector<std::string> names(batch);
+        for (size_t i = 0; i < batch; ++i) {
+            names[i] = "entity" + std::to_string(i);
+        }
+        int64_t timestamp = 0;
+        bench.run("ego_sphere/insert_entity_timestamp", {{"lookup_size", lookup_size}}, batch,
+                [&]() {
+                    ++timestamp;
+                    for (const auto& name : names) {
+                        ego_sphere.insertEntityTimestamp(name, timestamp);
+                    }
+                });
+    }
+}
+
+static void benchPeerTracker(Bench& bench) {
+    for (size_t n_dims : {2, 3}) {
+        for (size_t n_peers : {10, 100, 1000}) {
+            std::mt19937 gen(0);
+            PeerTracker peer_tracker({"self", "self", std::vector<float>(n_dims, 0)});
+            fb::FlatBufferBuilder fbb;
+            for (size_t i = 0; i < n_peers; ++i) {
+                NodeInfoT node_info;
+                node_info.name = node_info.address = "peer" + std::to_string(i);
+                node_info.coordinates = randomCoordinates(gen, n_dims, 100);
+                fbb.Clear();
+                fbb.Finish(NodeInfo::Pack(fbb, &node_info));
+                peer_tracker.updatePeer(fb::GetRoot<NodeInfo>(fbb.GetBufferPointer()));
+            }
+            std::vector<std::string> selected_peers, recipients;
+            // unchanged peers reuse the previous hull, moving self forces a rebuild
+            for (size_t moving : {0, 1}) {
+                Params params{{"peers", n_peers}, {"dims", n_dims}, {"moving", moving}};
+                auto self = peer_tracker.getNodeInfo().coordinates;
+                bench.run("peer_tracker/update_peer_selections", params, n_peers, [&]() {
+                    if (moving) {
+                        self[0] = self[0] ? 0 : 0.001f;
+                        peer_tracker.setCoordinates(self);
+                    }
+                    peer_tracker.updatePeerSelections(selected_peers, recipients);
+                });
+            }
+        }
+    }
+}
+
+static void benchQuickHull(Bench& bench) {
+    for (size_t n_dims : {2, 3, 4}) {
+        for (size_t n_points : {10, 100, 1000}) {
+            std::mt19937 gen(0);
+            std::vector<float> points;
+            for (size_t i = 0; i < n_points; ++i) {
+                auto point = randomCoordinates(gen, n_dims, 100);
+                points.insert(points.end(), point.begin(), point.end());
+            }
+            bench.run("quick_hull/convex_hull", {{"points", n_points}, {"dims", n_dims}},
+                    n_points, [&]() { QuickHull::convexHull(points.data(), n_points, n_dims); });
+        }
+    }
+}
+
+static void benchMeshNode(Bench& bench) {
+    for (size_t n_entities : {10, 100, 1000}) {
+        auto network = std::make_shared<InProcNetwork>();
+        MeshNode mesh_node({
+                1000,   // peer update interval
+                1000,   // entity expiry interval
+                8000,   // entity updates size
+                false,  // spectator
+                {},     // ego sphere
+                {"node", "node", {0, 0}},
+                std::make_shared<InProcTransport>(network, "node"),  // transport
+                nullptr,                                             // logger
+                [network]() { return network->getTime(); },         // local clock
+        });
+        auto entities = makeEntities(n_entities, 2);
+        std::vector<MessageBuffer> msgs;
+        uint8_t counter = 0;
+        bench.run("mesh_node/update_entities", {{"entities", n_entities}, {"dims", 2}},
+                n_entities, [&]() {
+                    ++counter;
+                    for (auto& entity : entities) {
+                        entity.data[0] = counter;
+                    }
+                    mesh_node.updateEntities(msgs, entities);
+                });
+    }
+}
+
+static void benchMessage(Bench& bench) {
+    for (size_t n_dims : {2, 3}) {
+        for (size_t n_entities : {10, 100, 1000}) {
+            Params params{{"entities", n_entities}, {"dims", n_dims}};
+            auto msg_t = makeMessage(n_entities, n_dims);
+            fb::FlatBufferBuilder fbb;
+            bench.run("message/pack", params, n_entities, [&]() { finishMessage(fbb, msg_t); });
+            // packed again since the benchmark above may be filtered out
+            finishMessage(fbb, msg_t);
+            auto buffer = fbb.GetBufferPointer();
+            auto size = fbb.GetSize();
+            bench.run("message/verify", params, n_entities, [&]() {
+                fb::Verifier verifier(buffer, size);
+                if (!fb::GetRoot<Message>(buffer)->Verify(verifier)) {
+                    std::abort();
+                }
+            });
+            MessageT unpacked;
+            bench.run("message/unpack", params, n_entities,
+                    [&]() { fb::GetRoot<Message>(buffer)->UnPackTo(&unpacked); });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Bench::Options options;
+    const char* json_path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const auto option = [arg](const char* name) {
+            const size_t len = std::strlen(name);
+            return !std::strncmp(arg, name, len) && arg[len] == '=' ? arg + len + 1 : nullptr;
+        };
+        const char* value;
+        if ((value = option("--json"))) {
+            json_path = value;
+        } else if ((value = option("--filter"))) {
+            options.filter = value;
+        } else if ((value = option("--samples"))) {
+            options.samples = std::max<size_t>(std::strtoul(value, nullptr, 10), 1);
+        } else if ((value = option("--min_sample_ms"))) {
+            options.min_sample_ms = std::strtoul(value, nullptr, 10);
+        } else {
+            std::fprintf(stderr, "unknown argument %s\n", arg);
+            return 1;
+        }
+    }
+    // keep stdout clean when JSON is written to it
+    if (json_path && !std::strcmp(json_path, "-")) {
+        options.table = stderr;
+    }
+
+    Bench bench(options);
+    benchEgoSphere(bench);
+    benchPeerTracker(bench);
+    benchQuickHull(bench);
+    benchMeshNode(bench);
+    benchMessage(bench);
+
+    if (json_path && !bench.writeJson(json_path)) {
+        std::fprintf(stderr, "failed to write %s\n", json_path);
+        return 1;
+    }
+    return 0;
+}
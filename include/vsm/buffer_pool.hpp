@@ -0,0 +1,93 @@
+#pragma once
+#include <flatbuffers/flatbuffers.h>
+
+#include <mutex>
+#include <vector>
+
+namespace vsm {
+
+namespace fb = flatbuffers;
+
+// Flatbuffers allocator that recycles freed blocks in power of two size classes.
+// Thread safe, so buffers detached from a builder can be released on any thread.
+class BufferPool : public fb::Allocator {
+public:
+    struct Stats {
+        size_t allocations = 0;  // blocks obtained from the heap
+        size_t reuses = 0;       // blocks served from the pool
+    };
+
+    // at most max_idle freed blocks are kept for reuse, the rest go back to the heap
+    BufferPool(size_t max_idle = 64)
+            : _max_idle(max_idle) {}
+
+    ~BufferPool() {
+        for (auto& blocks : _idle) {
+            for (auto block : blocks) {
+                delete[] block;
+            }
+        }
+    }
+
+    uint8_t* allocate(size_t size) override {
+        const size_t size_class = sizeClass(size);
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            auto& blocks = _idle[size_class];
+            if (!blocks.empty()) {
+                auto block = blocks.back();
+                blocks.pop_back();
+                --_idle_count;
+                ++_stats.reuses;
+                return block;
+            }
+            ++_stats.allocations;
+        }
+        return new uint8_t[size_t(1) << size_class];
+    }
+
+    void deallocate(uint8_t* p, size_t size) override {
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            if (_idle_count < _max_idle) {
+                // reserve up front so recycling never allocates
+                auto& blocks = _idle[sizeClass(size)];
+                if (blocks.capacity() < _max_idle) {
+                    blocks.reserve(_max_idle);
+                }
+                blocks.push_back(p);
+                ++_idle_count;
+                return;
+            }
+        }
+        delete[] p;
+    }
+
+    Stats getStats() const {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+
+    size_t idleCount() const {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        return _idle_count;
+    }
+
+private:
+    // smallest power of two exponent that fits size
+    static size_t sizeClass(size_t size) {
+        size_t size_class = 0;
+        while ((size_t(1) << size_class) < size) {
+            ++size_class;
+        }
+        return size_class;
+    }
+
+    std::vector<uint8_t*> _idle[sizeof(size_t) * 8];
+    size_t _idle_count = 0;
+    size_t _max_idle;
+    Stats _stats;
+    mutable std::mutex _mutex;
+};
+
+}  // namespace vsm
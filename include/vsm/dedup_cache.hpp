@@ -0,0 +1,121 @@
+#pragma once
+#include <vsm/hash.hpp>
+
+#include <vector>
+
+namespace vsm {
+
+// Fixed capacity set of 64 bit fingerprints with first-in first-out aging.
+// Open addressed with linear probing, no allocations after construction.
+class DedupCache {
+public:
+    struct Stats {
+        size_t lookups = 0;
+        size_t duplicates = 0;
+        size_t inserts = 0;
+        size_t evictions = 0;
+    };
+
+    explicit DedupCache(size_t capacity)
+            : _capacity(capacity ? capacity : 1)
+            , _fifo(_capacity, 0) {
+        // keep load factor at or below 0.5
+        size_t table_size = 2;
+        while (table_size < 2 * _capacity) {
+            table_size <<= 1;
+        }
+        _table.assign(table_size, 0);
+    }
+
+    static uint64_t fingerprint(const char* name, size_t len, int64_t timestamp) {
+        uint64_t fp = mixHash(hashBytes(name, len) ^ mixHash(static_cast<uint64_t>(timestamp)));
+        // zero marks an empty slot
+        return fp ? fp : 1;
+    }
+
+    bool contains(uint64_t fp) {
+        ++_stats.lookups;
+        if (_table[find(fp)] == fp) {
+            ++_stats.duplicates;
+            return true;
+        }
+        return false;
+    }
+
+    // returns false if fingerprint already exists, evicts the oldest entry when full
+    bool insert(uint64_t fp) {
+        size_t slot = find(fp);
+        if (_table[slot] == fp) {
+            ++_stats.duplicates;
+            return false;
+        }
+        if (_size == _capacity) {
+            erase(find(_fifo[_head]));
+            ++_stats.evictions;
+            // slot may have shifted during erase
+            slot = find(fp);
+        } else {
+            ++_size;
+        }
+        _table[slot] = fp;
+        _fifo[_head] = fp;
+        _head = (_head + 1) % _capacity;
+        ++_stats.inserts;
+        return true;
+    }
+
+    void clear() {
+        std::fill(_table.begin(), _table.end(), 0);
+        _size = 0;
+        _head = 0;
+    }
+
+    // estimated, not measured: chance that a new fingerprint collides with one of the stored ones,
+    // assuming fingerprints are uniformly distributed over 64 bits
+    double estimatedFalsePositiveRate() const { return _size / 18446744073709551616.0; }
+
+    // fraction of inserts that found the cache full and dropped the oldest fingerprint, a late
+    // duplicate of a dropped fingerprint is no longer detected
+    double evictionRate() const {
+        return _stats.inserts ? static_cast<double>(_stats.evictions) / _stats.inserts : 0;
+    }
+
+    // accessors
+    size_t size() const { return _size; }
+    size_t capacity() const { return _capacity; }
+    const Stats& getStats() const { return _stats; }
+
+private:
+    // returns slot containing fingerprint or the empty slot where it would be inserted
+    size_t find(uint64_t fp) const {
+        size_t mask = _table.size() - 1;
+        size_t slot = fp & mask;
+        while (_table[slot] && _table[slot] != fp) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // backward shift deletion keeps probe sequences intact without tombstones
+    void erase(size_t slot) {
+        size_t mask = _table.size() - 1;
+        for (size_t next = (slot + 1) & mask; _table[next]; next = (next + 1) & mask) {
+            size_t home = _table[next] & mask;
+            // move entry back if its home slot does not lie in (slot, next]
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                _table[slot] = _table[next];
+                slot = next;
+            }
+        }
+        _table[slot] = 0;
+    }
+
+    size_t _capacity;
+    size_t _size = 0;
+    size_t _head = 0;
+    std::vector<uint64_t> _table;
+    std::vector<uint64_t> _fifo;
+    Stats _stats;
+};
+
+}  // namespace vsm
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define VSM_DISTANCE_SSE
+#endif
+
+namespace vsm {
+
+// fixed dimension for callers that know it at compile time, sizes are not checked
+template <size_t N, class VecA, class VecB>
+float distanceSqr(const VecA& a, const VecB& b) {
+    float d2 = 0;
+    for (size_t i = 0; i < N; ++i) {
+        float d = b[i] - a[i];
+        d2 += d * d;
+    }
+    return d2;
+}
+
+template <class VecA, class VecB>
+float distanceSqr(const VecA& a, const VecB& b) {
+    if (a.size() != b.size()) {
+        return std::numeric_limits<float>::max();
+    }
+    float d2 = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        float d = b[i] - a[i];
+        d2 += d * d;
+    }
+    return d2;
+}
+
+// Scores one point against n_points packed in rows, where row i holds coordinate i of every point.
+// Distances are summed in dimension order, so results match distanceSqr bit for bit.
+template <class Vec>
+void distanceSqrBatch(float* distances, const Vec& point, const float* rows, size_t n_points) {
+    for (size_t j = 0; j < n_points; ++j) {
+        distances[j] = 0;
+    }
+    for (size_t i = 0; i < point.size(); ++i) {
+        const float coord = point[i];
+        const float* row = rows + i * n_points;
+        size_t j = 0;
+#ifdef VSM_DISTANCE_SSE
+        const __m128 coords = _mm_set1_ps(coord);
+        for (; j + 4 <= n_points; j += 4) {
+            const __m128 d = _mm_sub_ps(coords, _mm_loadu_ps(row + j));
+            _mm_storeu_ps(distances + j, _mm_add_ps(_mm_loadu_ps(distances + j), _mm_mul_ps(d, d)));
+        }
+#endif
+        for (; j < n_points; ++j) {
+            float d = coord - row[j];
+            distances[j] += d * d;
+        }
+    }
+}
+
+}  // namespace vsm
@@ -1,18 +1,59 @@
 #pragma once
+#include <vsm/dedup_cache.hpp>
 #include <vsm/logger.hpp>
 #include <vsm/msg_types_generated.h>
 #include <vsm/peer_tracker.hpp>
+#include <vsm/spatial_grid.hpp>
+#include <vsm/string_interner.hpp>
 
 #include <functional>
-#include <set>
+#include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace vsm {
 
 namespace fb = flatbuffers;
 
+// copy an entity table into another builder without unpacking it
+fb::Offset<Entity> copyEntity(fb::FlatBufferBuilder& fbb, const Entity* entity);
+
+// same as above but with timestamp and hops made relative to a different message
+fb::Offset<Entity> copyEntity(fb::FlatBufferBuilder& fbb, const Entity* entity,
+        int64_t timestamp_offset, uint32_t hops_offset);
+
+// timestamp and hops of an entity, which may differ from its message if it was merged
+static inline int64_t entityTimestamp(const Message* msg, const Entity* entity) {
+    return msg->timestamp() + entity->timestamp_offset();
+}
+static inline uint32_t entityHops(const Message* msg, const Entity* entity) {
+    return msg->hops() + entity->hops_offset();
+}
+
+// owns a single entity serialized as a compact flatbuffer, accessed through a read-only view
+class EntityBuffer {
+public:
+    EntityBuffer() = default;
+    EntityBuffer(const uint8_t* buffer, size_t len)
+            : _buffer(buffer, buffer + len) {}
+
+    // reuses existing storage when the new entity fits
+    void assign(const uint8_t* buffer, size_t len) { _buffer.assign(buffer, buffer + len); }
+
+    const Entity* get() const {
+        return _buffer.empty() ? nullptr : fb::GetRoot<Entity>(_buffer.data());
+    }
+    const Entity* operator->() const { return get(); }
+
+    const uint8_t* data() const { return _buffer.data(); }
+    size_t size() const { return _buffer.size(); }
+
+private:
+    std::vector<uint8_t> _buffer;
+};
+
 class EgoSphere {
 public:
     enum ErrorType {
@@ -39,60 +80,160 @@ public:
     };
 
     struct EntityUpdate {
-        EntityT entity;
+        EntityBuffer entity;
         int64_t receive_timestamp;
         int64_t source_timestamp;
         uint32_t hops;
+        size_t expiry_index;    // position in the expiry heap, maintained by EgoSphere
+        int64_t lod_timestamp;  // last update sent beyond level of detail distance, min if none
     };
 
-    // return value determines whether to allow update
-    using EntityUpdateHandler = std::function<bool(
-            EntityUpdate* new_entity, const EntityUpdate* old_entity, const NodeInfoT& source)>;
+    // Called before an update is stored, returning false rejects it. new_entity is null when the
+    // entity is deleted or expires, the return value is ignored then.
+    // Behavior change: new_entity used to be mutable and edits were stored and forwarded. Accepted
+    // updates are now forwarded from the received bytes, so new_entity is const and a handler can
+    // only accept or reject. To change an entity, reject the update and send the edited entity
+    // with MeshNode::updateEntities instead.
+    using EntityUpdateHandler = std::function<bool(const EntityUpdate* new_entity,
+            const EntityUpdate* old_entity, const NodeInfoT& source)>;
 
     struct Config {
         EntityUpdateHandler entity_update_handler = nullptr;
         size_t timestamp_lookup_size = 1024;
-    };
-
-    struct EntityTimestamp {
-        std::string name;
-        int64_t timestamp;
-        bool operator<(const EntityTimestamp& rhs) const {
-            return timestamp == rhs.timestamp ? name < rhs.name : timestamp < rhs.timestamp;
-        }
+        float spatial_cell_size = 1;  // grid cell width of the spatial index
+        bool entity_snapshots = false;  // publish immutable snapshots for lock-free readers
     };
 
     using EntityLookup = std::unordered_map<std::string, EntityUpdate>;
+    using EntityQuery = std::vector<const EntityLookup::value_type*>;
+    using EntitySnapshot = std::shared_ptr<const EntityLookup>;
 
     EgoSphere(Config config, std::shared_ptr<Logger> logger = nullptr)
             : _config(config)
+            , _spatial_index(_config.spatial_cell_size, entityCoordinates)
+            , _timestamps(_config.timestamp_lookup_size)
+            , _snapshot(_config.entity_snapshots ? std::make_shared<const EntityLookup>() : nullptr)
             , _entity_update_handler(std::move(_config.entity_update_handler))
             , _logger(std::move(logger)){};
 
-    std::vector<fb::Offset<Entity>> receiveEntityUpdates(fb::FlatBufferBuilder& fbb,
-            const Message* msg, const PeerTracker& peer_tracker,
-            const std::vector<std::string>& connected_peers, int64_t current_time);
+    // returns entities of msg to be forwarded, in message order
+    // nearest filter considers self and the peers set by PeerTracker::setNearestPeers
+    std::vector<const Entity*> receiveEntityUpdates(
+            const Message* msg, const PeerTracker& peer_tracker, int64_t current_time) {
+        std::vector<const Entity*> forward_entities;
+        receiveEntityUpdates(forward_entities, msg, peer_tracker, current_time);
+        return forward_entities;
+    }
+
+    // same as above but refills forward_entities so its storage can be reused
+    void receiveEntityUpdates(std::vector<const Entity*>& forward_entities, const Message* msg,
+            const PeerTracker& peer_tracker, int64_t current_time) {
+        forward_entities.clear();
+        appendEntityUpdates(forward_entities, msg, peer_tracker, current_time);
+    }
+
+    // applies a burst of messages in order, forward_entities is refilled with the entities of
+    // all of them and forward_counts with how many of those came from each message
+    void receiveEntityUpdatesBatch(std::vector<const Entity*>& forward_entities,
+            std::vector<size_t>& forward_counts, const Message* const* msgs, size_t n_msgs,
+            const PeerTracker& peer_tracker, int64_t current_time);
+
+    // whether an update of entity is due for peers beyond level of detail distance, true once the
+    // interval passed since the last marked update and always for entities that aren't stored
+    bool lodUpdateDue(const Entity* entity, int64_t current_time, int64_t interval) const;
+    // records that an update of entity was sent to peers beyond level of detail distance
+    void markLodUpdate(const Entity* entity, int64_t current_time);
 
-    bool insertEntityTimestamp(std::string name, int64_t timestamp);
+    bool insertEntityTimestamp(const std::string& name, int64_t timestamp) {
+        return insertEntityTimestamp(DedupCache::fingerprint(name.data(), name.size(), timestamp));
+    }
 
     bool deleteEntity(const std::string& name, const NodeInfoT& source);
 
     void expireEntities(int64_t current_time, const NodeInfoT& source);
 
+    // publish changes since the last call as a new snapshot, no-op if snapshots are disabled
+    void publishSnapshot();
+
+    // latest published snapshot, safe to call from any thread
+    EntitySnapshot getSnapshot() const { return std::atomic_load(&_snapshot); }
+
+    // entities within radius of center, unordered
+    EntityQuery queryRadius(const std::vector<float>& center, float radius) const {
+        EntityQuery results;
+        _spatial_index.queryRadius(results, center, radius);
+        return results;
+    }
+
+    // k entities nearest to center, sorted by increasing distance
+    EntityQuery queryKNearest(const std::vector<float>& center, size_t k) const {
+        EntityQuery results;
+        _spatial_index.queryKNearest(results, center, k);
+        return results;
+    }
+
     // accesors
     void setEntityUpdateHandler(EntityUpdateHandler handler) {
         _entity_update_handler = std::move(handler);
     }
-    EntityLookup& getEntities() { return _entities; }
     const EntityLookup& getEntities() const { return _entities; }
+    const DedupCache& getTimestamps() const { return _timestamps; }
 
     Logger* getLogger() { return _logger.get(); }
     const Logger* getLogger() const { return _logger.get(); }
 
 private:
+    void appendEntityUpdates(std::vector<const Entity*>& forward_entities, const Message* msg,
+            const PeerTracker& peer_tracker, int64_t current_time);
+
+    static const fb::Vector<float>* entityCoordinates(const EntityLookup::value_type* entity) {
+        return entity->second.entity->coordinates();
+    }
+
+    bool insertEntityTimestamp(uint64_t fingerprint);
+
+    // looks up entity by name without allocating, returns null if not found
+    const EntityLookup::value_type* findEntity(const char* name, size_t len) const {
+        const auto id = _names.find(name, len);
+        return id == StringInterner::INVALID_ID ? nullptr : _entities_by_id[id];
+    }
+    EntityLookup::value_type* findEntity(const char* name, size_t len) {
+        return const_cast<EntityLookup::value_type*>(
+                static_cast<const EgoSphere*>(this)->findEntity(name, len));
+    }
+
+    void deleteEntity(EntityLookup::value_type* entity, const NodeInfoT& source);
+    void eraseEntity(EntityLookup::value_type* entity);
+
+    void markDirty(const std::string& name) {
+        if (_config.entity_snapshots) {
+            _dirty.insert(name);
+        }
+    }
+
+    // binary min-heap of entities ordered by expiry
+    using ExpiryHeap = std::vector<std::pair<int64_t, EntityLookup::value_type*>>;
+
+    void pushExpiry(EntityLookup::value_type* entity);
+    void updateExpiry(size_t index, int64_t expiry);
+    void eraseExpiry(size_t index);
+    void siftExpiry(size_t index);
+    void swapExpiry(size_t a, size_t b);
+
     Config _config;
     EntityLookup _entities;
-    std::set<EntityTimestamp> _timestamps;
+    StringInterner _names;
+    std::vector<EntityLookup::value_type*> _entities_by_id;
+    ExpiryHeap _expiry_heap;
+    SpatialGrid<EntityLookup::value_type> _spatial_index;
+    EntityUpdate _new_entity;
+    NodeInfoT _source;
+    fb::FlatBufferBuilder _entity_fbb;
+    DedupCache _timestamps;
+    EntitySnapshot _snapshot;
+    std::shared_ptr<EntityLookup> _back_snapshot;
+    std::unordered_set<std::string> _dirty;
+    std::unordered_set<std::string> _back_dirty;
     EntityUpdateHandler _entity_update_handler;
     std::shared_ptr<Logger> _logger;
 };
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace vsm {
+
+// 64 bit FNV-1a hash of a byte string
+static inline uint64_t hashBytes(const void* data, size_t len, uint64_t hash = 0xcbf29ce484222325) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+// splitmix64 finalizer, spreads entropy across all bits
+static inline uint64_t mixHash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+}  // namespace vsm
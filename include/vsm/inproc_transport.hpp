@@ -0,0 +1,178 @@
+#pragma once
+#include <vsm/transport.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vsm {
+
+class InProcTransport;
+
+// Simulated network connecting InProcTransports within one process.
+// Time is virtual and only advances while events are run, so runs are repeatable for a seed.
+class InProcNetwork {
+public:
+    struct Config {
+        float latency_ms = 1;      // one way delay of every message
+        float jitter_ms = 0;       // uniformly distributed extra delay
+        float loss = 0;            // probability of a message being dropped
+        float bandwidth_kbps = 0;  // uplink of each transport, 0 is unlimited
+        uint32_t seed = 0;         // seeds jitter and loss
+    };
+
+    struct Stats {
+        size_t tx_messages = 0;
+        size_t tx_bytes = 0;
+        size_t rx_messages = 0;
+        size_t rx_bytes = 0;
+        size_t dropped_messages = 0;
+        int64_t cpu_ns = 0;  // wall time spent in receiver and timer callbacks
+    };
+
+    InProcNetwork();
+    InProcNetwork(Config config);
+
+    // no copy or move since transports point back to the network
+    InProcNetwork(const InProcNetwork&) = delete;
+    InProcNetwork& operator=(const InProcNetwork&) = delete;
+
+    // virtual time in nanoseconds, suitable as MeshNode::Config::local_clock
+    int64_t getTime() const { return _time.load(std::memory_order_relaxed); }
+
+    // runs events in time order for duration_ms of virtual time, returns number of events run
+    size_t run(size_t duration_ms);
+
+    // runs the next event only, advancing time to it, returns false if there are none
+    bool step();
+
+    // accessors
+    const Config& getConfig() const { return _config; }
+    size_t pendingEvents() const;
+
+private:
+    friend class InProcTransport;
+
+    // shared payload of a message fanned out to several recipients
+    struct Packet {
+        std::string group;
+        std::vector<uint8_t> copy;
+        void* buffer = nullptr;
+        size_t len = 0;
+        Transport::ReleaseCallback release = nullptr;
+        void* hint = nullptr;
+        ~Packet() {
+            if (release) {
+                release(buffer, hint);
+            }
+        }
+    };
+
+    // message delivery if timer_id is 0, otherwise a timer expiry
+    struct Event {
+        int64_t time;
+        uint64_t sequence;  // keeps events at equal times in submission order
+        uint32_t transport_id;
+        int timer_id;
+        std::shared_ptr<const Packet> packet;
+        bool operator<(const Event& rhs) const {
+            return time != rhs.time ? time > rhs.time : sequence > rhs.sequence;
+        }
+    };
+
+    uint32_t addTransport(InProcTransport* transport);
+    void removeTransport(uint32_t transport_id);
+    // must be called with _mutex held
+    void pushEvent(int64_t time, uint32_t transport_id, int timer_id,
+            std::shared_ptr<const Packet> packet = nullptr);
+    // runs the earliest event if it is due at or before deadline, returns false otherwise
+    bool runNext(int64_t deadline);
+    // moves time forward to at least time
+    void advanceTime(int64_t time);
+
+    Config _config;
+    std::atomic<int64_t> _time{0};
+    uint64_t _sequence = 0;
+    std::vector<Event> _events;  // heap ordered by time
+    std::vector<InProcTransport*> _transports;
+    std::unordered_map<std::string, uint32_t> _transport_ids;
+    std::mt19937 _random;
+    mutable std::mutex _mutex;
+};
+
+// Transport attached to an InProcNetwork, addresses are arbitrary unique strings.
+// Timers run on the virtual clock of the network.
+class InProcTransport : public Transport {
+public:
+    // common interface
+    const char* getAddress() const override { return _address.c_str(); }
+
+    int connect(const char* dst_addr) override;
+    int disconnect(const char* dst_addr) override;
+
+    int transmit(const void* buffer, size_t len, const char* group = "") override {
+        return transmitExcept(buffer, len, nullptr, group);
+    }
+    int transmitTo(const void* buffer, size_t len, const std::vector<std::string>& dst_addrs,
+            const char* group = "") override;
+    int transmitExcept(const void* buffer, size_t len, const char* exclude_addr,
+            const char* group = "") override;
+
+    // owned buffers are delivered without copying and released after the last delivery
+    int transmit(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* group = "") override {
+        return transmitExcept(buffer, len, release, hint, nullptr, group);
+    }
+    int transmitTo(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const std::vector<std::string>& dst_addrs, const char* group = "") override;
+    int transmitExcept(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* exclude_addr, const char* group = "") override;
+
+    int addReceiver(ReceiverCallback receiver_callback, const char* group = "") override;
+    int addTimer(size_t interval_ms, TimerCallback timer_callback) override;
+
+    // a burst is every message delivered to this transport at the same virtual time
+    int addBurstCallback(BurstCallback burst_callback) override;
+
+    // runs the network until a message is received or timeout_ms of virtual time has passed
+    int poll(size_t timeout_ms) override;
+
+    // implementation specific
+    InProcTransport(std::shared_ptr<InProcNetwork> network, std::string address);
+    ~InProcTransport();
+
+    // no copy or move since the network points to the transport
+    InProcTransport(const InProcTransport&) = delete;
+    InProcTransport& operator=(const InProcTransport&) = delete;
+
+    InProcNetwork::Stats getStats() const;
+    InProcNetwork& getNetwork() { return *_network; }
+
+private:
+    friend class InProcNetwork;
+
+    // schedules delivery to each connected recipient, either dst_addrs or all but exclude_addr
+    int transmitPacket(std::shared_ptr<InProcNetwork::Packet> packet, const char* group,
+            const std::vector<std::string>* dst_addrs, const char* exclude_addr);
+    void sendTo(const std::string& dst_addr, const std::shared_ptr<InProcNetwork::Packet>& packet);
+
+    std::shared_ptr<InProcNetwork> _network;
+    std::string _address;
+    uint32_t _id;
+    // guarded by the network mutex
+    std::unordered_set<std::string> _destinations;
+    int64_t _uplink_free_time = 0;
+    InProcNetwork::Stats _stats;
+    // interval and callback of each timer, indexed by timer id - 1
+    std::vector<std::pair<int64_t, TimerCallback>> _timers;
+    std::unordered_map<std::string, ReceiverCallback> _receiver_callbacks;
+    std::vector<BurstCallback> _burst_callbacks;
+};
+
+}  // namespace vsm
@@ -1,24 +1,43 @@
 #pragma once
 
+#include <vsm/buffer_pool.hpp>
 #include <vsm/logger.hpp>
+#include <vsm/mpsc_queue.hpp>
 #include <vsm/ego_sphere.hpp>
 #include <vsm/peer_tracker.hpp>
+#include <vsm/spsc_queue.hpp>
+#include <vsm/string_interner.hpp>
 #include <vsm/time_sync.hpp>
 #include <vsm/transport.hpp>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 namespace vsm {
 
 template <class T>
 using Locked = std::pair<T&, std::unique_lock<std::mutex>>;
 
+template <class T>
+using LockedResult = std::pair<T, std::unique_lock<std::mutex>>;
+
 struct MessageBuffer : public fb::DetachedBuffer {
     using fb::DetachedBuffer::DetachedBuffer;
-    MessageBuffer(fb::DetachedBuffer&& buffer)
-            : fb::DetachedBuffer(std::move(buffer)){};
+    MessageBuffer(fb::DetachedBuffer&& buffer, std::shared_ptr<BufferPool> pool = nullptr)
+            : fb::DetachedBuffer(std::move(buffer))
+            , _pool(std::move(pool)){};
+    MessageBuffer(MessageBuffer&&) = default;
+    MessageBuffer& operator=(MessageBuffer&&) = default;
+    // hand storage back while the pool it came from is still alive
+    ~MessageBuffer() { static_cast<fb::DetachedBuffer&>(*this) = fb::DetachedBuffer(); }
+
     const Message* get() const { return data() ? fb::GetRoot<Message>(data()) : nullptr; }
     Message* get() { return data() ? fb::GetMutableRoot<Message>(data()) : nullptr; }
+
+private:
+    std::shared_ptr<BufferPool> _pool;
 };
 
 class MeshNode {
@@ -30,6 +49,8 @@ public:
         ADD_MESSAGE_HANDLER_FAIL,
         ADD_TIMER_FAIL,
         MESSAGE_VERIFY_FAIL,
+        PIPELINE_QUEUE_FULL,
+        SUBMIT_QUEUE_FULL,
         // Info
         INITIALIZED,
         // Debug
@@ -57,6 +78,29 @@ public:
                     std::chrono::steady_clock::now().time_since_epoch())
                     .count();
         };
+        size_t buffer_pool_size = 64;  // idle message buffers kept for reuse
+        // verify threads, 0 processes messages and timers on the polling thread instead
+        size_t pipeline_workers = 0;
+        size_t pipeline_queue_size = 1024;  // messages buffered between each pipeline stage
+        // bursts of up to this many received messages are applied under one lock and forwarded
+        // together, needs pipeline workers or a transport that reports bursts
+        size_t receive_batch_size = 0;
+        // received entities are forwarded after at most this long, with older pending updates of
+        // the same entity dropped, 0 forwards each message right away
+        size_t forward_coalesce_ms = 0;
+        // updateEntities stages entities and sends only the newest state of each once per this
+        // interval, 0 sends on every call
+        size_t update_coalesce_ms = 0;
+        // entities passed to submitEntities from any thread, 0 disables submitting
+        size_t submit_queue_size = 0;
+        size_t submit_interval_ms = 10;  // how often the polling thread sends submitted entities
+        // peers farther than this from an entity get at most one of its updates per lod interval
+        // and nearer ones get all of them, 0 forwards every update to every peer
+        float lod_distance = 0;
+        size_t lod_interval_ms = 100;
+        // lets forwards merge entities of different messages by sending their own timestamp and
+        // hops as entity offsets, only enable once every peer understands those
+        bool merge_forwards = false;
     };
 
     // no copy or move since there are callbacks anchored
@@ -66,6 +110,7 @@ public:
     MeshNode& operator=(MeshNode&&) = delete;
 
     MeshNode(Config config);
+    ~MeshNode();
 
     // entities interface
     Locked<const EgoSphere::EntityLookup> getEntities() const {
@@ -73,12 +118,45 @@ public:
                 _ego_sphere.getEntities(), std::unique_lock<std::mutex>(_entities_mutex)};
     }
 
+    // requires ego_sphere.entity_snapshots, never blocks on entity updates
+    EgoSphere::EntitySnapshot getEntitiesSnapshot() const { return _ego_sphere.getSnapshot(); }
+
+    // results point into the entity lookup and are only valid while the lock is held
+    LockedResult<EgoSphere::EntityQuery> queryRadius(
+            const std::vector<float>& center, float radius) const {
+        std::unique_lock<std::mutex> lock(_entities_mutex);
+        return {_ego_sphere.queryRadius(center, radius), std::move(lock)};
+    }
+
+    LockedResult<EgoSphere::EntityQuery> queryKNearest(
+            const std::vector<float>& center, size_t k) const {
+        std::unique_lock<std::mutex> lock(_entities_mutex);
+        return {_ego_sphere.queryKNearest(center, k), std::move(lock)};
+    }
+
     void offsetRelativeExpiry(std::vector<EntityT>& entities) const;
 
     std::vector<MessageBuffer> updateEntities(const std::vector<EntityT>& entities);
 
+    // same as above but refills forwarded_messages so its storage can be reused
+    void updateEntities(
+            std::vector<MessageBuffer>& forwarded_messages, const std::vector<EntityT>& entities);
+
+    // queues entities to be sent by the polling thread as if passed to updateEntities there,
+    // never blocks and returns how many were queued before the submit queue filled up,
+    // rejected entities are counted and logged later by the polling thread
+    size_t submitEntities(const std::vector<EntityT>& entities);
+
+    // with update coalescing, updateEntities returns no messages and staged entities are sent by
+    // a timer or by calling this, no-op otherwise
+    void flushEntityUpdates();
+
     const Message* forwardEntityUpdates(fb::FlatBufferBuilder& fbb, const Message* msg);
 
+    // passes the buffer through with hops and source patched when every entity is forwarded
+    const Message* forwardEntityUpdates(
+            fb::FlatBufferBuilder& fbb, const void* buffer, size_t len);
+
     // accessors (FYI they are not thread safe)
     EgoSphere& getEgoSphere() { return _ego_sphere; }
     const EgoSphere& getEgoSphere() const { return _ego_sphere; }
@@ -92,29 +170,179 @@ public:
     Transport& getTransport() { return *_transport; }
     const Transport& getTransport() const { return *_transport; }
 
+    const BufferPool& getBufferPool() const { return *_buffer_pool; }
+
     Logger* getLogger() { return _logger.get(); }
     const Logger* getLogger() const { return _logger.get(); }
 
     const std::vector<std::string>& getConnectedPeers() const { return _connected_peers; }
 
+    // blocks until every message and timer received so far has been applied, no-op unpipelined
+    void flushPipeline() const;
+
 private:
+    // entity to be forwarded with the timestamp and hops it was received with
+    struct ForwardEntry {
+        const Entity* entity;
+        int64_t timestamp;
+        uint32_t hops;
+        const char* src_addr;
+    };
+
+    // scratch storage for building forwarded messages, reused by one thread at a time
+    struct ForwardContext {
+        std::vector<const Entity*> entities;
+        std::vector<fb::Offset<Entity>> offsets;
+        std::vector<ForwardEntry> entries;
+        // entries sent per peer, keep holds a flag per entry for each of peers
+        std::vector<std::string> peers;
+        std::vector<uint8_t> keep;
+        std::vector<uint8_t> due;
+        std::vector<uint8_t> far;
+        std::vector<uint8_t> grouped;
+        std::vector<std::string> recipients;
+    };
+
+    // copy of a received entity waiting for the coalescing window to close
+    struct PendingForward {
+        uint32_t name_id;
+        EntityBuffer entity;
+        int64_t timestamp;
+        uint32_t hops;
+        std::string src_addr;
+    };
+
+    // unit of work passed from the polling thread through a worker to the apply thread
+    struct PipelineItem {
+        enum Kind {
+            MESSAGE,
+            INVALID,   // failed verification, logged when applied
+            REJECTED,  // dropped without logging
+            PEER_UPDATE,
+            ENTITY_EXPIRY,
+            FORWARD_FLUSH,
+            ENTITY_FLUSH,
+            ENTITY_SUBMIT,
+        } kind;
+        std::vector<uint8_t> buffer;
+    };
+
+    // items are dealt round robin to workers and collected in the same order when applied
+    struct PipelineWorker {
+        PipelineWorker(size_t queue_size)
+                : input(queue_size)
+                , output(queue_size) {}
+        SpscQueue<PipelineItem> input;
+        SpscQueue<PipelineItem> output;
+        std::thread thread;
+    };
+
     // internall callbacks
     void sendPeerUpdates();
+    void expireEntities();
+    void sendSubmittedEntities();
+    // requires _update_mutex
+    void stageEntities(const EntityT* entities, size_t n_entities);
+    void sendEntityUpdates(std::vector<MessageBuffer>& forwarded_messages,
+            const EntityT* entities, size_t n_entities);
     void receiveMessageHandler(const void* buffer, size_t len);
+    // doesn't log so it can run on pipeline workers
+    static bool verifyMessage(const void* buffer, size_t& len);
+    void applyMessage(const void* buffer, size_t len);
+    // returns whether entity updates of msg should be applied
+    bool applyPeerUpdates(const Message* msg, const void* buffer, size_t len);
+    // received messages are collected into burst buffers until applied together
+    std::vector<uint8_t>& nextBurstBuffer();
+    void applyBurst();
+    void forwardEntityUpdatesBatch();
+    // requires _entities_mutex, fills the per peer state and returns whether it's needed
+    bool selectForwardEntries(ForwardContext& context, const std::vector<ForwardEntry>& entries);
+    // sends entries merged into as few messages as entity updates size allows
+    void transmitForwardEntries(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+            const std::vector<ForwardEntry>& entries, bool per_peer);
+    // only entries flagged in keep go to recipients, all go to every peer but a shared source if
+    // those are null
+    void transmitEntries(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+            const std::vector<ForwardEntry>& entries, const uint8_t* keep,
+            const std::vector<std::string>* recipients);
+    // these require _entities_mutex, they fill the per peer state and return whether some peers
+    // only get part of entries
+    bool excludeSources(ForwardContext& context, const std::vector<ForwardEntry>& entries);
+    bool applyLevelOfDetail(ForwardContext& context, const std::vector<ForwardEntry>& entries);
+    void transmitPerPeer(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+            const std::vector<ForwardEntry>& entries);
+    // holds entries back until the coalescing window closes or a full message is pending
+    void coalesceForwardEntries(const std::vector<ForwardEntry>& entries);
+    void flushForwards();
+    // pipeline stages
+    bool pushPipeline(PipelineItem::Kind kind, const void* buffer, size_t len, bool block);
+    void runPipelineWorker(PipelineWorker& worker, const std::string& self_address);
+    void runPipelineApply();
+    // release_buffer hands the built message to the transport instead of copying it
+    bool forwardEntityUpdates(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+            const Message* msg, const void* buffer, size_t len, bool release_buffer);
+    int transmitBuffer(fb::FlatBufferBuilder& fbb, const char* exclude_addr);
+    int transmitBuffer(fb::FlatBufferBuilder& fbb, const std::vector<std::string>& dst_addrs);
+    bool passThroughMessage(fb::FlatBufferBuilder& fbb, const void* buffer, size_t len);
 
     EgoSphere _ego_sphere;
     PeerTracker _peer_tracker;
     TimeSync _time_sync;
     std::shared_ptr<Transport> _transport;
     std::shared_ptr<Logger> _logger;
+    std::shared_ptr<BufferPool> _buffer_pool;
     fb::FlatBufferBuilder _fbb;
+    ForwardContext _receive_context;
+    // updateEntities state, guarded by _update_mutex
+    fb::FlatBufferBuilder _update_fbb_in;
+    fb::FlatBufferBuilder _update_fbb_out;
+    ForwardContext _update_context;
+    std::vector<fb::Offset<Entity>> _update_offsets;
+    // staged entities indexed by name id, ids stay dense since names are cleared on every flush
+    StringInterner _staged_names;
+    std::vector<EntityT> _staged_entities;
+    std::vector<MessageBuffer> _staged_messages;
+    // submitted entities, drained only by the polling thread
+    std::unique_ptr<MpscQueue<EntityT>> _submit_queue;
+    // entities rejected by a full submit queue, logged by the polling thread
+    std::atomic<size_t> _submit_drops{0};
+    std::vector<EntityT> _submitted_entities;
+    std::vector<MessageBuffer> _submitted_messages;
+    std::mutex _update_mutex;
     std::vector<fb::Offset<NodeInfo>> _peer_offsets;
     std::vector<std::string> _selected_peers;
     std::vector<std::string> _connected_peers;
+    // coordinates of each connected peer as of the last peer update, empty if unknown
+    std::vector<std::vector<float>> _connected_coordinates;
     std::vector<std::string> _recipients_buffer;
+    // burst state, only used by the thread applying received messages
+    std::vector<std::vector<uint8_t>> _burst_buffers;
+    size_t _burst_size = 0;
+    std::vector<const Message*> _burst_msgs;
+    std::vector<size_t> _burst_forward_counts;
+    // coalesced forwards in arrival order, storage of flushed ones is reused
+    std::vector<PendingForward> _pending_forwards;
+    size_t _n_pending_forwards = 0;
+    size_t _pending_forward_bytes = 0;
+    StringInterner _pending_forward_names;
+    std::vector<size_t> _pending_forward_slots;  // index into pending forwards by name id
+    fb::FlatBufferBuilder _pending_forward_fbb;
+    std::vector<ForwardEntry> _flush_entries;
     mutable std::mutex _entities_mutex;
     size_t _entity_updates_size;
+    size_t _receive_batch_size;
+    bool _merge_forwards;
+    float _lod_distance;
+    int64_t _lod_interval;
+    bool _forward_coalesce;
+    bool _update_coalesce;
     bool _spectator;
+    // pipeline state, sequences count items pushed by the polling thread and applied
+    std::vector<std::unique_ptr<PipelineWorker>> _pipeline_workers;
+    std::thread _pipeline_apply_thread;
+    std::atomic<size_t> _pipeline_pushed{0};
+    std::atomic<size_t> _pipeline_applied{0};
+    std::atomic<bool> _pipeline_running{false};
 };
 
 }  // namespace vsm
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace vsm {
+
+// Bounded lock-free queue from any number of producer threads to exactly one consumer thread.
+// Each slot carries a sequence number so producers only contend on claiming the tail index.
+// Values are assigned into slots in place, so storage held by T (eg. vector capacity) is reused.
+template <class T>
+class MpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    MpscQueue(size_t capacity)
+            : _slots(roundUp(capacity))
+            , _mask(_slots.size() - 1) {
+        for (size_t i = 0; i < _slots.size(); ++i) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // no copy or move since the indices are shared between threads
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // any thread: assigns value to a free slot, false without blocking if the queue is full
+    template <class U>
+    bool push(U&& value) {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = _slots[tail & _mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == tail) {
+                // slot is free, claim it before filling
+                if (_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(value);
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (sequence < tail) {
+                // slot still holds the value from one lap ago
+                return false;
+            } else {
+                // another producer claimed it first
+                tail = _tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer: oldest published slot, null if the queue is empty or the next one is being filled
+    T* front() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        Slot& slot = _slots[head & _mask];
+        return slot.sequence.load(std::memory_order_acquire) == head + 1 ? &slot.value : nullptr;
+    }
+
+    // consumer: hand the slot returned by front() back to the producers for the next lap
+    void pop() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        _slots[head & _mask].sequence.store(head + _slots.size(), std::memory_order_release);
+        _head.store(head + 1, std::memory_order_relaxed);
+    }
+
+    // approximate when called concurrently with push() or pop(), includes slots being filled
+    size_t size() const {
+        return _tail.load(std::memory_order_relaxed) - _head.load(std::memory_order_relaxed);
+    }
+    size_t capacity() const { return _slots.size(); }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<Slot> _slots;
+    const size_t _mask;
+    // indices only increase, consumer state followed by producer state
+    std::atomic<size_t> _head{0};
+    char _padding[64];  // keeps the two on separate cache lines
+    std::atomic<size_t> _tail{0};
+};
+
+}  // namespace vsm
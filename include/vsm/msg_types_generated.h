@@ -348,6 +348,8 @@ struct EntityT : public flatbuffers::NativeTable {
   float range = 0.0f;
   int64_t expiry = 0;
   std::vector<uint8_t> data{};
+  int64_t timestamp_offset = 0;
+  uint32_t hops_offset = 0;
 };
 
 struct Entity FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
@@ -363,7 +365,9 @@ struct Entity FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_HOP_LIMIT = 10,
     VT_RANGE = 12,
     VT_EXPIRY = 14,
-    VT_DATA = 16
+    VT_DATA = 16,
+    VT_TIMESTAMP_OFFSET = 18,
+    VT_HOPS_OFFSET = 20
   };
   const flatbuffers::String *name() const {
     return GetPointer<const flatbuffers::String *>(VT_NAME);
@@ -413,6 +417,18 @@ struct Entity FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   flatbuffers::Vector<uint8_t> *mutable_data() {
     return GetPointer<flatbuffers::Vector<uint8_t> *>(VT_DATA);
   }
+  int64_t timestamp_offset() const {
+    return GetField<int64_t>(VT_TIMESTAMP_OFFSET, 0);
+  }
+  bool mutate_timestamp_offset(int64_t _timestamp_offset) {
+    return SetField<int64_t>(VT_TIMESTAMP_OFFSET, _timestamp_offset, 0);
+  }
+  uint32_t hops_offset() const {
+    return GetField<uint32_t>(VT_HOPS_OFFSET, 0);
+  }
+  bool mutate_hops_offset(uint32_t _hops_offset) {
+    return SetField<uint32_t>(VT_HOPS_OFFSET, _hops_offset, 0);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyOffsetRequired(verifier, VT_NAME) &&
@@ -425,6 +441,8 @@ struct Entity FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            VerifyField<int64_t>(verifier, VT_EXPIRY) &&
            VerifyOffset(verifier, VT_DATA) &&
            verifier.VerifyVector(data()) &&
+           VerifyField<int64_t>(verifier, VT_TIMESTAMP_OFFSET) &&
+           VerifyField<uint32_t>(verifier, VT_HOPS_OFFSET) &&
            verifier.EndTable();
   }
   EntityT *UnPack(const flatbuffers::resolver_function_t *_resolver = nullptr) const;
@@ -457,6 +475,12 @@ struct EntityBuilder {
   void add_data(flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data) {
     fbb_.AddOffset(Entity::VT_DATA, data);
   }
+  void add_timestamp_offset(int64_t timestamp_offset) {
+    fbb_.AddElement<int64_t>(Entity::VT_TIMESTAMP_OFFSET, timestamp_offset, 0);
+  }
+  void add_hops_offset(uint32_t hops_offset) {
+    fbb_.AddElement<uint32_t>(Entity::VT_HOPS_OFFSET, hops_offset, 0);
+  }
   explicit EntityBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -477,9 +501,13 @@ inline flatbuffers::Offset<Entity> CreateEntity(
     uint32_t hop_limit = 0,
     float range = 0.0f,
     int64_t expiry = 0,
-    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data = 0) {
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> data = 0,
+    int64_t timestamp_offset = 0,
+    uint32_t hops_offset = 0) {
   EntityBuilder builder_(_fbb);
+  builder_.add_timestamp_offset(timestamp_offset);
   builder_.add_expiry(expiry);
+  builder_.add_hops_offset(hops_offset);
   builder_.add_data(data);
   builder_.add_range(range);
   builder_.add_hop_limit(hop_limit);
@@ -497,7 +525,9 @@ inline flatbuffers::Offset<Entity> CreateEntityDirect(
     uint32_t hop_limit = 0,
     float range = 0.0f,
     int64_t expiry = 0,
-    const std::vector<uint8_t> *data = nullptr) {
+    const std::vector<uint8_t> *data = nullptr,
+    int64_t timestamp_offset = 0,
+    uint32_t hops_offset = 0) {
   auto name__ = name ? _fbb.CreateString(name) : 0;
   auto coordinates__ = coordinates ? _fbb.CreateVector<float>(*coordinates) : 0;
   auto data__ = data ? _fbb.CreateVector<uint8_t>(*data) : 0;
@@ -509,7 +539,9 @@ inline flatbuffers::Offset<Entity> CreateEntityDirect(
       hop_limit,
       range,
       expiry,
-      data__);
+      data__,
+      timestamp_offset,
+      hops_offset);
 }
 
 flatbuffers::Offset<Entity> CreateEntity(flatbuffers::FlatBufferBuilder &_fbb, const EntityT *_o, const flatbuffers::rehasher_function_t *_rehasher = nullptr);
@@ -606,6 +638,8 @@ inline void Entity::UnPackTo(EntityT *_o, const flatbuffers::resolver_function_t
   { auto _e = range(); _o->range = _e; }
   { auto _e = expiry(); _o->expiry = _e; }
   { auto _e = data(); if (_e) { _o->data.resize(_e->size()); std::copy(_e->begin(), _e->end(), _o->data.begin()); } }
+  { auto _e = timestamp_offset(); _o->timestamp_offset = _e; }
+  { auto _e = hops_offset(); _o->hops_offset = _e; }
 }
 
 inline flatbuffers::Offset<Entity> Entity::Pack(flatbuffers::FlatBufferBuilder &_fbb, const EntityT* _o, const flatbuffers::rehasher_function_t *_rehasher) {
@@ -623,6 +657,8 @@ inline flatbuffers::Offset<Entity> CreateEntity(flatbuffers::FlatBufferBuilder &
   auto _range = _o->range;
   auto _expiry = _o->expiry;
   auto _data = _o->data.size() ? _fbb.CreateVector(_o->data) : 0;
+  auto _timestamp_offset = _o->timestamp_offset;
+  auto _hops_offset = _o->hops_offset;
   return vsm::CreateEntity(
       _fbb,
       _name,
@@ -631,7 +667,9 @@ inline flatbuffers::Offset<Entity> CreateEntity(flatbuffers::FlatBufferBuilder &
       _hop_limit,
       _range,
       _expiry,
-      _data);
+      _data,
+      _timestamp_offset,
+      _hops_offset);
 }
 
 }  // namespace vsm
@@ -1,36 +1,50 @@
 #pragma once
+#include <vsm/distance.hpp>
 #include <vsm/logger.hpp>
 #include <vsm/msg_types_generated.h>
+#include <vsm/quick_hull.hpp>
+#include <vsm/string_interner.hpp>
 
 #include <limits>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace vsm {
 
-template <class VecA, class VecB>
-float distanceSqr(const VecA& a, const VecB& b) {
-    if (a.size() != b.size()) {
-        return std::numeric_limits<float>::max();
-    }
-    float d2 = 0;
-    for (size_t i = 0; i < a.size(); ++i) {
-        float d = b[i] - a[i];
-        d2 += d * d;
-    }
-    return d2;
-}
+namespace fb = flatbuffers;
 
 static inline uint32_t add32(uint32_t a, uint32_t b) {
     return (a > 0xFFFFFFFF - b) ? 0xFFFFFFFF : a + b;
 }
 
+// same as NodeInfo::UnPackTo but assigns into existing storage instead of reallocating
+static inline void unpackNodeInfo(const NodeInfo* node_info, NodeInfoT& node_info_t) {
+    if (auto name = node_info->name()) {
+        node_info_t.name.assign(name->c_str(), name->size());
+    }
+    if (auto address = node_info->address()) {
+        node_info_t.address.assign(address->c_str(), address->size());
+    }
+    if (auto coordinates = node_info->coordinates()) {
+        node_info_t.coordinates.resize(coordinates->size());
+        for (size_t i = 0; i < coordinates->size(); ++i) {
+            node_info_t.coordinates[i] = coordinates->Get(i);
+        }
+    }
+    node_info_t.group_mask = node_info->group_mask();
+    node_info_t.sequence = node_info->sequence();
+}
+
 struct Peer {
     NodeInfoT node_info;
     uint32_t source_sequence = 0;
     uint32_t latch_until = 0;
     uint32_t track_until = 0;
+    // selection state, inverted coordinates are empty if peer was not a candidate
+    std::vector<float> inverted_coordinates;
+    bool on_hull = false;
 };
 
 class PeerTracker {
@@ -81,9 +95,28 @@ public:
     // accessors (FYI they are not thread safe)
     const PeerLookup& getPeers() const { return _peers; }
 
-    NodeInfoT& getNodeInfo() { return _node_info; }
+    // self node info is only changed through the setters so its serialized copy stays current
     const NodeInfoT& getNodeInfo() const { return _node_info; }
 
+    void setName(std::string name) {
+        _node_info.name = std::move(name);
+        packNodeInfo();
+    }
+    void setCoordinates(std::vector<float> coordinates) {
+        _node_info.coordinates = std::move(coordinates);
+        packNodeInfo();
+    }
+    void setGroupMask(uint32_t group_mask) {
+        _node_info.group_mask = group_mask;
+        packNodeInfo();
+    }
+
+    // serialized self node info, re-packed whenever it changes so only use on the owning thread
+    const fb::FlatBufferBuilder& getNodeInfoBuffer() const { return _node_info_fbb; }
+
+    // embed a copy of the serialized node info into another builder, safe from any thread
+    fb::Offset<NodeInfo> copyNodeInfo(fb::FlatBufferBuilder& fbb) const;
+
     Logger* getLogger() { return _logger.get(); }
     const Logger* getLogger() const { return _logger.get(); }
 
@@ -93,24 +126,98 @@ public:
         const auto* nearest_node = &_node_info;
         float min_distance_sqr = distanceSqr(coordinates, nearest_node->coordinates);
         for (const auto& peer_address : peers) {
-            auto peer = _peers.find(peer_address);
-            if (peer == _peers.end()) {
+            auto peer = findPeer(peer_address.data(), peer_address.size());
+            if (!peer) {
                 continue;
             }
-            float distance_sqr = distanceSqr(coordinates, peer->second.node_info.coordinates);
+            float distance_sqr = distanceSqr(coordinates, peer->node_info.coordinates);
             if (distance_sqr < min_distance_sqr) {
                 min_distance_sqr = distance_sqr;
-                nearest_node = &peer->second.node_info;
+                nearest_node = &peer->node_info;
+            }
+        }
+        return *nearest_node;
+    }
+
+    // restricts nearestPeer(coordinates) to self and the given peers, their node info is copied
+    // and packed here so later peer updates only take effect on the next call
+    void setNearestPeers(const std::vector<std::string>& peers);
+
+    // same result as nearestPeer(coordinates, peers) as of the last setNearestPeers,
+    // only reads the packed copies so it can run while peers are being updated
+    template <class Vec>
+    const NodeInfoT& nearestPeer(const Vec& coordinates) const {
+        const auto* nearest_node = &_node_info;
+        float min_distance_sqr = distanceSqr(coordinates, nearest_node->coordinates);
+        // only peers matching the packed dimension are in the packed coordinates
+        if (coordinates.size() != _nearest_dims) {
+            for (const auto& node : _nearest_nodes) {
+                float distance_sqr = distanceSqr(coordinates, node.coordinates);
+                if (distance_sqr < min_distance_sqr) {
+                    min_distance_sqr = distance_sqr;
+                    nearest_node = &node;
+                }
             }
+            return *nearest_node;
+        }
+        // blocks are scored into a stack buffer so concurrent queries share no scratch state
+        float distances[NEAREST_BLOCK];
+        const float* block = _nearest_coordinates.data();
+        const size_t n_peers = _nearest_packed.size();
+        for (size_t k = 0; k < n_peers; k += NEAREST_BLOCK) {
+            distanceSqrBatch(distances, coordinates, block, NEAREST_BLOCK);
+            const size_t n_block = n_peers - k < NEAREST_BLOCK ? n_peers - k : NEAREST_BLOCK;
+            for (size_t j = 0; j < n_block; ++j) {
+                if (distances[j] < min_distance_sqr) {
+                    min_distance_sqr = distances[j];
+                    nearest_node = _nearest_packed[k + j];
+                }
+            }
+            block += NEAREST_BLOCK * _nearest_dims;
         }
         return *nearest_node;
     }
 
 private:
+    // looks up peer by address without allocating, returns null if not found
+    const Peer* findPeer(const char* address, size_t len) const {
+        const auto id = _addresses.find(address, len);
+        return id == StringInterner::INVALID_ID ? nullptr : &_peers_by_id[id]->second;
+    }
+    Peer* findPeer(const char* address, size_t len) {
+        return const_cast<Peer*>(static_cast<const PeerTracker*>(this)->findPeer(address, len));
+    }
+
+    Peer& insertPeer(const char* address, size_t len);
+
+    // serializes self node info after it changed
+    void packNodeInfo();
+
+    // computes hull over _hull_candidates where null stands for the origin
+    void selectHull(size_t n_dims);
+
     Config _config;
     PeerLookup _peers;
+    StringInterner _addresses;
+    std::vector<PeerLookup::value_type*> _peers_by_id;
     NodeInfoT _node_info;
+    std::vector<float> _selection_origin;
+    std::vector<Peer*> _candidate_peers;
+    std::vector<Peer*> _added_peers;
+    std::vector<Peer*> _hull_candidates;
+    std::vector<Peer*> _hull_peers;
+    size_t _hull_vertices = 0;  // distinct points in _hull_peers
+    std::vector<float> _hull_coordinates;
+    fb::FlatBufferBuilder _node_info_fbb;
+    mutable std::mutex _node_info_mutex;  // guards _node_info_fbb against copies on other threads
     std::vector<std::string> _recipients;
+    // copies of the nearest peers, those matching _nearest_dims are also packed in blocks where
+    // row i of a block holds coordinate i of its peers, the last block is padded with zeros
+    static constexpr size_t NEAREST_BLOCK = 8;
+    std::vector<NodeInfoT> _nearest_nodes;
+    std::vector<const NodeInfoT*> _nearest_packed;
+    std::vector<float> _nearest_coordinates;
+    size_t _nearest_dims = 0;
     std::shared_ptr<Logger> _logger;
 };
 
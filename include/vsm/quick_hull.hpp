@@ -22,6 +22,11 @@ public:
 
     static PointSet convexHull(const std::vector<Point>& points, bool include_coplanar = false,
             Value epsilon = std::numeric_limits<Value>::epsilon());
+
+    // points are packed contiguously with stride n_dims, returns hull indices in ascending order
+    static std::vector<size_t> convexHull(const Value* points, size_t n_points, size_t n_dims,
+            bool include_coplanar = false, Value epsilon = std::numeric_limits<Value>::epsilon());
     static void sphereInversion(std::vector<Point>& points, const Point& origin);
+    static void sphereInversion(Point& point, const Point& origin);
 };
 }  // namespace vsm
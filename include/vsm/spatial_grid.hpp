@@ -0,0 +1,224 @@
+#pragma once
+#include <vsm/hash.hpp>
+#include <vsm/msg_types_generated.h>
+#include <vsm/peer_tracker.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vsm {
+
+namespace fb = flatbuffers;
+
+// Uniform grid over the first three coordinates of each item, maintained incrementally.
+// Cells only narrow down candidates, every result passes an exact full dimension distance check.
+template <class T>
+class SpatialGrid {
+public:
+    using Coordinates = fb::Vector<float>;
+    using CoordinatesAccessor = const Coordinates* (*)(const T*);
+
+    SpatialGrid(float cell_size, CoordinatesAccessor get_coordinates)
+            : _cell_size(cell_size > 0 ? cell_size : 1)
+            , _get_coordinates(get_coordinates) {}
+
+    // items without coordinates are not indexed
+    void insert(const T* item, const Coordinates* coordinates) {
+        if (coordinates && coordinates->size()) {
+            _cells[cellKey(*coordinates)].push_back(item);
+            ++_size;
+        }
+    }
+
+    // coordinates must be the ones the item was inserted with
+    void erase(const T* item, const Coordinates* coordinates) {
+        if (!coordinates || !coordinates->size()) {
+            return;
+        }
+        auto cell = _cells.find(cellKey(*coordinates));
+        if (cell == _cells.end()) {
+            return;
+        }
+        auto& items = cell->second;
+        auto found = std::find(items.begin(), items.end(), item);
+        if (found == items.end()) {
+            return;
+        }
+        *found = items.back();
+        items.pop_back();
+        --_size;
+        if (items.empty()) {
+            _cells.erase(cell);
+        }
+    }
+
+    // only touches the grid when the item changes cells
+    void update(const T* item, const Coordinates* old_coordinates,
+            const Coordinates* new_coordinates) {
+        bool old_valid = old_coordinates && old_coordinates->size();
+        bool new_valid = new_coordinates && new_coordinates->size();
+        if (old_valid && new_valid && cellKey(*old_coordinates) == cellKey(*new_coordinates)) {
+            return;
+        }
+        erase(item, old_coordinates);
+        insert(item, new_coordinates);
+    }
+
+    void clear() {
+        _cells.clear();
+        _size = 0;
+    }
+
+    // all items within radius of center, unordered
+    void queryRadius(std::vector<const T*>& results, const std::vector<float>& center,
+            float radius) const {
+        if (center.empty() || radius < 0) {
+            return;
+        }
+        const float radius_sqr = radius * radius;
+        const auto visit = [&](const std::vector<const T*>& items) {
+            for (const T* item : items) {
+                if (distanceSqr(*_get_coordinates(item), center) <= radius_sqr) {
+                    results.push_back(item);
+                }
+            }
+        };
+        // scan occupied cells directly when the query box spans more cells than are occupied
+        int32_t lo[3] = {0, 0, 0};
+        int32_t hi[3] = {0, 0, 0};
+        const size_t dims = std::min<size_t>(center.size(), 3);
+        double box_cells = 1;
+        for (size_t i = 0; i < dims; ++i) {
+            lo[i] = cellIndex(center[i] - radius);
+            hi[i] = cellIndex(center[i] + radius);
+            box_cells *= static_cast<double>(hi[i]) - lo[i] + 1;
+        }
+        if (box_cells > _cells.size()) {
+            for (const auto& cell : _cells) {
+                visit(cell.second);
+            }
+            return;
+        }
+        for (int32_t x = lo[0]; x <= hi[0]; ++x) {
+            for (int32_t y = lo[1]; y <= hi[1]; ++y) {
+                for (int32_t z = lo[2]; z <= hi[2]; ++z) {
+                    auto cell = _cells.find(cellKey(x, y, z));
+                    if (cell != _cells.end()) {
+                        visit(cell->second);
+                    }
+                }
+            }
+        }
+    }
+
+    // k items nearest to center, sorted by increasing distance
+    void queryKNearest(
+            std::vector<const T*>& results, const std::vector<float>& center, size_t k) const {
+        if (center.empty() || !k) {
+            return;
+        }
+        // max heap of the k best candidates found so far
+        std::vector<std::pair<float, const T*>> candidates;
+        const auto visit = [&](const std::vector<const T*>& items) {
+            for (const T* item : items) {
+                float dist_sqr = distanceSqr(*_get_coordinates(item), center);
+                if (dist_sqr == std::numeric_limits<float>::max()) {
+                    continue;
+                } else if (candidates.size() < k) {
+                    candidates.emplace_back(dist_sqr, item);
+                    std::push_heap(candidates.begin(), candidates.end());
+                } else if (dist_sqr < candidates.front().first) {
+                    std::pop_heap(candidates.begin(), candidates.end());
+                    candidates.back() = {dist_sqr, item};
+                    std::push_heap(candidates.begin(), candidates.end());
+                }
+            }
+        };
+        // expand shells of cells around the center cell until nothing closer can remain
+        const size_t dims = std::min<size_t>(center.size(), 3);
+        int32_t origin[3] = {0, 0, 0};
+        for (size_t i = 0; i < dims; ++i) {
+            origin[i] = cellIndex(center[i]);
+        }
+        size_t visited_items = 0;
+        for (int32_t ring = 0;; ++ring) {
+            // fall back to a full scan once a shell spans more cells than are occupied
+            double box_cells = std::pow(2.0 * ring + 1, dims);
+            if (box_cells > 2.0 * _cells.size()) {
+                candidates.clear();
+                for (const auto& cell : _cells) {
+                    visit(cell.second);
+                }
+                break;
+            }
+            const int32_t span[3] = {ring, dims > 1 ? ring : 0, dims > 2 ? ring : 0};
+            for (int32_t x = -span[0]; x <= span[0]; ++x) {
+                for (int32_t y = -span[1]; y <= span[1]; ++y) {
+                    for (int32_t z = -span[2]; z <= span[2]; ++z) {
+                        // only visit the surface of the shell
+                        if (std::max({std::abs(x), std::abs(y), std::abs(z)}) != ring) {
+                            continue;
+                        }
+                        auto cell = _cells.find(
+                                cellKey(origin[0] + x, origin[1] + y, origin[2] + z));
+                        if (cell != _cells.end()) {
+                            visit(cell->second);
+                            visited_items += cell->second.size();
+                        }
+                    }
+                }
+            }
+            // unvisited cells are at least ring cells away from center
+            const float bound = ring * _cell_size;
+            if (visited_items >= _size ||
+                    (candidates.size() == k && candidates.front().first <= bound * bound)) {
+                break;
+            }
+        }
+        std::sort_heap(candidates.begin(), candidates.end());
+        for (const auto& candidate : candidates) {
+            results.push_back(candidate.second);
+        }
+    }
+
+    // accessors
+    float getCellSize() const { return _cell_size; }
+    size_t size() const { return _size; }
+    size_t cellCount() const { return _cells.size(); }
+
+private:
+    struct CellHash {
+        size_t operator()(uint64_t key) const { return mixHash(key); }
+    };
+
+    int32_t cellIndex(float coordinate) const {
+        // clamp so out of range and non finite coordinates map to valid cells
+        float index = std::floor(coordinate / _cell_size);
+        return index >= 1e6f ? 1000000 : index >= -1e6f ? static_cast<int32_t>(index) : -1000000;
+    }
+
+    static uint64_t cellKey(int32_t x, int32_t y, int32_t z) {
+        // 21 bits per axis covers the clamped index range
+        return (static_cast<uint64_t>(x & 0x1FFFFF) << 42) |
+               (static_cast<uint64_t>(y & 0x1FFFFF) << 21) | static_cast<uint64_t>(z & 0x1FFFFF);
+    }
+
+    uint64_t cellKey(const Coordinates& coordinates) const {
+        int32_t index[3] = {0, 0, 0};
+        for (size_t i = 0; i < std::min<size_t>(coordinates.size(), 3); ++i) {
+            index[i] = cellIndex(coordinates[i]);
+        }
+        return cellKey(index[0], index[1], index[2]);
+    }
+
+    float _cell_size;
+    CoordinatesAccessor _get_coordinates;
+    size_t _size = 0;
+    std::unordered_map<uint64_t, std::vector<const T*>, CellHash> _cells;
+};
+
+}  // namespace vsm
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace vsm {
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+// Slots are filled and read in place, so storage held by T (eg. vector capacity) is reused.
+template <class T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    SpscQueue(size_t capacity)
+            : _slots(roundUp(capacity))
+            , _mask(_slots.size() - 1) {}
+
+    // no copy or move since the indices are shared between threads
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // producer: free slot to fill before push(), null if the queue is full
+    T* back() {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head_cache == _slots.size()) {
+            _head_cache = _head.load(std::memory_order_acquire);
+            if (tail - _head_cache == _slots.size()) {
+                return nullptr;
+            }
+        }
+        return &_slots[tail & _mask];
+    }
+
+    // producer: publish the slot returned by back()
+    void push() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer: oldest published slot, null if the queue is empty
+    T* front() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail_cache) {
+            _tail_cache = _tail.load(std::memory_order_acquire);
+            if (head == _tail_cache) {
+                return nullptr;
+            }
+        }
+        return &_slots[head & _mask];
+    }
+
+    // consumer: hand the slot returned by front() back to the producer
+    void pop() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // approximate when called concurrently with push() or pop()
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return _slots.size(); }
+
+private:
+    static size_t roundUp(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> _slots;
+    const size_t _mask;
+    // indices only increase, consumer state followed by producer state
+    std::atomic<size_t> _head{0};
+    size_t _tail_cache = 0;
+    char _padding[64];  // keeps the two on separate cache lines
+    std::atomic<size_t> _tail{0};
+    size_t _head_cache = 0;
+};
+
+}  // namespace vsm
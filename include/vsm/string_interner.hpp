@@ -0,0 +1,132 @@
+#pragma once
+#include <vsm/hash.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace vsm {
+
+// Maps strings to dense 32 bit ids, looked up from raw bytes without allocating.
+// Released ids are recycled, so an id only identifies its string while it stays interned.
+class StringInterner {
+public:
+    enum : uint32_t { INVALID_ID = 0xFFFFFFFF };
+
+    StringInterner()
+            : _table(16, INVALID_ID) {}
+
+    // returns INVALID_ID if not interned
+    uint32_t find(const char* str, size_t len) const {
+        return _table[find(str, len, hash(str, len))];
+    }
+    uint32_t find(const std::string& str) const { return find(str.data(), str.size()); }
+
+    // returns existing id or interns a copy of the string
+    uint32_t intern(const char* str, size_t len) {
+        const uint64_t str_hash = hash(str, len);
+        size_t slot = find(str, len, str_hash);
+        if (_table[slot] != INVALID_ID) {
+            return _table[slot];
+        }
+        // keep load factor at or below 0.5
+        if (2 * (size() + 1) > _table.size()) {
+            rehash(2 * _table.size());
+            slot = find(str, len, str_hash);
+        }
+        uint32_t id;
+        if (_free_ids.empty()) {
+            id = static_cast<uint32_t>(_strings.size());
+            _strings.emplace_back(str, len);
+            _hashes.push_back(str_hash);
+        } else {
+            id = _free_ids.back();
+            _free_ids.pop_back();
+            // reuses the capacity of the released string
+            _strings[id].assign(str, len);
+            _hashes[id] = str_hash;
+        }
+        _table[slot] = id;
+        return id;
+    }
+    uint32_t intern(const std::string& str) { return intern(str.data(), str.size()); }
+
+    void release(uint32_t id) {
+        size_t slot = find(_strings[id].data(), _strings[id].size(), _hashes[id]);
+        if (_table[slot] != id) {
+            return;
+        }
+        erase(slot);
+        _strings[id].clear();
+        _free_ids.push_back(id);
+    }
+
+    void clear() {
+        std::fill(_table.begin(), _table.end(), INVALID_ID);
+        _strings.clear();
+        _hashes.clear();
+        _free_ids.clear();
+    }
+
+    // accessors
+    const std::string& str(uint32_t id) const { return _strings[id]; }
+    size_t size() const { return _strings.size() - _free_ids.size(); }
+    // upper bound of ids in use, suitable for sizing id indexed tables
+    size_t idBound() const { return _strings.size(); }
+
+private:
+    static uint64_t hash(const char* str, size_t len) { return mixHash(hashBytes(str, len)); }
+
+    // returns slot containing the string or the empty slot where it would be inserted
+    size_t find(const char* str, size_t len, uint64_t str_hash) const {
+        size_t mask = _table.size() - 1;
+        size_t slot = str_hash & mask;
+        for (; _table[slot] != INVALID_ID; slot = (slot + 1) & mask) {
+            const uint32_t id = _table[slot];
+            if (_hashes[id] == str_hash && _strings[id].size() == len &&
+                    !std::memcmp(_strings[id].data(), str, len)) {
+                break;
+            }
+        }
+        return slot;
+    }
+
+    void rehash(size_t table_size) {
+        std::vector<uint32_t> old_table(table_size, INVALID_ID);
+        old_table.swap(_table);
+        size_t mask = table_size - 1;
+        for (auto id : old_table) {
+            if (id == INVALID_ID) {
+                continue;
+            }
+            size_t slot = _hashes[id] & mask;
+            while (_table[slot] != INVALID_ID) {
+                slot = (slot + 1) & mask;
+            }
+            _table[slot] = id;
+        }
+    }
+
+    // backward shift deletion keeps probe sequences intact without tombstones
+    void erase(size_t slot) {
+        size_t mask = _table.size() - 1;
+        for (size_t next = (slot + 1) & mask; _table[next] != INVALID_ID;
+                next = (next + 1) & mask) {
+            size_t home = _hashes[_table[next]] & mask;
+            // move entry back if its home slot does not lie in (slot, next]
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                _table[slot] = _table[next];
+                slot = next;
+            }
+        }
+        _table[slot] = INVALID_ID;
+    }
+
+    std::vector<uint32_t> _table;
+    std::vector<std::string> _strings;
+    std::vector<uint64_t> _hashes;
+    std::vector<uint32_t> _free_ids;
+};
+
+}  // namespace vsm
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstddef>
 #include <functional>
+#include <string>
+#include <vector>
 
 namespace vsm {
 
@@ -8,17 +10,52 @@ class Transport {
 public:
     using ReceiverCallback = std::function<void(const void* buffer, size_t len)>;
     using TimerCallback = std::function<void(int timer_id)>;
+    using ReleaseCallback = void (*)(void* buffer, void* hint);
+    using BurstCallback = std::function<void()>;
 
     virtual const char* getAddress() const = 0;
 
-    // these 3 functions are expected to be thread-safe
+    // connect, disconnect and every transmit, transmitTo and transmitExcept overload are expected
+    // to be thread-safe, they may be called from other threads while poll is running
     virtual int connect(const char* dst_addr) = 0;
     virtual int disconnect(const char* dst_addr) = 0;
     virtual int transmit(const void* buffer, size_t len, const char* group = "") = 0;
 
+    // send to a subset of connected addresses without changing connection state
+    virtual int transmitTo(const void* buffer, size_t len,
+            const std::vector<std::string>& dst_addrs, const char* group = "") = 0;
+    virtual int transmitExcept(const void* buffer, size_t len, const char* exclude_addr,
+            const char* group = "") = 0;
+
+    // same as above but take ownership of buffer so it can be sent without a copy,
+    // release(buffer, hint) is called exactly once when done, possibly from another thread
+    virtual int transmit(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* group = "") {
+        int result = transmit(static_cast<const void*>(buffer), len, group);
+        release(buffer, hint);
+        return result;
+    }
+    virtual int transmitTo(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const std::vector<std::string>& dst_addrs, const char* group = "") {
+        int result = transmitTo(static_cast<const void*>(buffer), len, dst_addrs, group);
+        release(buffer, hint);
+        return result;
+    }
+    virtual int transmitExcept(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* exclude_addr, const char* group = "") {
+        int result = transmitExcept(static_cast<const void*>(buffer), len, exclude_addr, group);
+        release(buffer, hint);
+        return result;
+    }
+
+    // the rest need not be thread-safe, call them from the thread that polls, where callbacks run
     virtual int addReceiver(ReceiverCallback receiver_callback, const char* group = "") = 0;
     virtual int addTimer(size_t interval_ms, TimerCallback timer_callback) = 0;
 
+    // called after the last message of every burst delivered together by poll, so receivers can
+    // process the burst at once, returns -1 if the transport doesn't report bursts
+    virtual int addBurstCallback(BurstCallback) { return -1; }
+
     virtual int poll(size_t timeout_ms) = 0;  // -1 = inf, 0 = non-blocking
 };
 
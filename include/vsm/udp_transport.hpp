@@ -0,0 +1,96 @@
+#pragma once
+#include <vsm/transport.hpp>
+#include <vsm/zmq_timers.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vsm {
+
+// Transport over plain UDP sockets (linux only).
+// Bursts are drained with recvmmsg and each message is fanned out to all recipients with one
+// sendmmsg call. Datagrams are laid out as [group length][group][padding][payload], with the
+// header padded to a multiple of 8 bytes so payloads can be read as flatbuffers in place.
+class UdpTransport : public Transport {
+public:
+    // common interface
+    const char* getAddress() const override { return _address.c_str(); }
+
+    int connect(const char* dst_addr) override;
+    int disconnect(const char* dst_addr) override;
+
+    int transmit(const void* buffer, size_t len, const char* group = "") override {
+        return transmitExcept(buffer, len, nullptr, group);
+    }
+    int transmitTo(const void* buffer, size_t len, const std::vector<std::string>& dst_addrs,
+            const char* group = "") override;
+    int transmitExcept(const void* buffer, size_t len, const char* exclude_addr,
+            const char* group = "") override;
+
+    // the kernel copies on send, so owned buffers are released right away
+    using Transport::transmit;
+    using Transport::transmitExcept;
+    using Transport::transmitTo;
+
+    int addReceiver(ReceiverCallback receiver_callback, const char* group = "") override {
+        _receiver_callbacks[group] = receiver_callback;
+        return 0;
+    }
+
+    // called at the end of each poll that received messages
+    int addBurstCallback(BurstCallback burst_callback) override {
+        _burst_callbacks.emplace_back(std::move(burst_callback));
+        return 0;
+    }
+
+    int addTimer(size_t interval_ms, TimerCallback timer_callback) override {
+        return _timers.add(interval_ms, std::move(timer_callback));
+    }
+
+    int poll(size_t timeout_ms) override;
+
+    // implementation specific
+    // batch_size datagrams of up to max_message_size bytes are received per system call
+    UdpTransport(std::string address = "udp://*:11511", size_t batch_size = 32,
+            size_t max_message_size = 8192);
+    ~UdpTransport();
+
+    // no copy or move since receive buffers are referenced by address
+    UdpTransport(const UdpTransport&) = delete;
+    UdpTransport& operator=(const UdpTransport&) = delete;
+
+    int getSocket() const { return _socket; }
+
+    // parses udp://host:port, * for any host, returns false if invalid
+    static bool parseAddress(const char* address, sockaddr_in& sock_addr);
+
+private:
+    // sends to each selected recipient, must be called with _tx_mutex held
+    int sendToRecipients(const void* buffer, size_t len, const char* group);
+
+    static constexpr size_t ALIGNMENT = 8;
+    static size_t alignUp(size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    std::string _address;
+    int _socket;
+    size_t _max_message_size;
+    // send state, guarded by _tx_mutex
+    std::unordered_map<std::string, sockaddr_in> _destinations;
+    std::vector<mmsghdr> _tx_msgs;
+    std::mutex _tx_mutex;
+    // receive state, only used from poll
+    std::vector<uint8_t> _rx_buffer;
+    std::vector<iovec> _rx_iovecs;
+    std::vector<mmsghdr> _rx_msgs;
+    std::string _rx_group;
+    ZmqTimers _timers;
+    std::unordered_map<std::string, ReceiverCallback> _receiver_callbacks;
+    std::vector<BurstCallback> _burst_callbacks;
+};
+
+}  // namespace vsm
@@ -2,6 +2,7 @@
 #include <vsm/transport.hpp>
 #include <vsm/zmq_timers.hpp>
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -12,24 +13,38 @@ public:
     // common interface
     const char* getAddress() const { return _address.c_str(); }
 
-    int connect(const char* dst_addr) override {
-        return zmq_connect(_tx_socket.handle(), dst_addr);
-    }
-    int disconnect(const char* dst_addr) override {
-        return zmq_disconnect(_tx_socket.handle(), dst_addr);
-    }
+    int connect(const char* dst_addr) override;
+    int disconnect(const char* dst_addr) override;
 
     int transmit(const void* buffer, size_t len, const char* group = "") override {
-        zmq::message_t msg(buffer, len);
-        msg.set_group(group);
-        return zmq_sendmsg(_tx_socket.handle(), msg.handle(), 0);
+        return transmitExcept(buffer, len, nullptr, group);
+    }
+    int transmitTo(const void* buffer, size_t len, const std::vector<std::string>& dst_addrs,
+            const char* group = "") override;
+    int transmitExcept(const void* buffer, size_t len, const char* exclude_addr,
+            const char* group = "") override;
+
+    // zero copy, the buffer is released once every recipient socket has sent it
+    int transmit(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* group = "") override {
+        return transmitExcept(buffer, len, release, hint, nullptr, group);
     }
+    int transmitTo(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const std::vector<std::string>& dst_addrs, const char* group = "") override;
+    int transmitExcept(void* buffer, size_t len, ReleaseCallback release, void* hint,
+            const char* exclude_addr, const char* group = "") override;
 
     int addReceiver(ReceiverCallback receiver_callback, const char* group = "") override {
         _receiver_callbacks[group] = receiver_callback;
         return zmq_join(_rx_socket.handle(), group);
     }
 
+    // called at the end of each poll that received messages
+    int addBurstCallback(BurstCallback burst_callback) override {
+        _burst_callbacks.emplace_back(std::move(burst_callback));
+        return 0;
+    }
+
     int addTimer(size_t interval_ms, TimerCallback timer_callback) override {
         return _timers.add(interval_ms, std::move(timer_callback));
     }
@@ -39,18 +54,27 @@ public:
     // implementation specific
     ZmqTransport(std::string address = "udp://*:11511");
 
-    const zmq::socket_t& getTxSocket() const { return _tx_socket; }
     const zmq::socket_t& getRxSocket() const { return _rx_socket; }
     zmq::context_t& getContext() { return _zmq_ctx; }
 
 private:
+    // recipient selection, must be called with _tx_mutex held
+    void selectRecipients(const std::vector<std::string>& dst_addrs);
+    void selectRecipients(const char* exclude_addr);
+    // sends msg to each selected recipient, sharing the payload instead of copying it for each
+    int sendToRecipients(zmq::message_t& msg, const char* group);
+
     std::string _address;
     zmq::context_t _zmq_ctx;
-    zmq::socket_t _tx_socket;
+    // one radio socket per destination so recipients can be chosen per message
+    std::unordered_map<std::string, zmq::socket_t> _tx_sockets;
+    std::vector<zmq::socket_t*> _tx_recipients;
+    std::mutex _tx_mutex;
     zmq::socket_t _rx_socket;
     zmq::message_t _rx_message;
     ZmqTimers _timers;
     std::unordered_map<std::string, ReceiverCallback> _receiver_callbacks;
+    std::vector<BurstCallback> _burst_callbacks;
 };
 
 }  // namespace vsm
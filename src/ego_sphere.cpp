@@ -1,27 +1,63 @@
 #include <vsm/ego_sphere.hpp>
 #include <algorithm>
+#include <atomic>
+#include <limits>
 
 namespace vsm {
 
-std::vector<fb::Offset<Entity>> EgoSphere::receiveEntityUpdates(fb::FlatBufferBuilder& fbb,
-        const Message* msg, const PeerTracker& peer_tracker,
-        const std::vector<std::string>& connected_peers, int64_t current_time) {
-    std::vector<fb::Offset<Entity>> forward_entities;
+fb::Offset<Entity> copyEntity(fb::FlatBufferBuilder& fbb, const Entity* entity) {
+    return copyEntity(fbb, entity, entity->timestamp_offset(), entity->hops_offset());
+}
+
+fb::Offset<Entity> copyEntity(fb::FlatBufferBuilder& fbb, const Entity* entity,
+        int64_t timestamp_offset, uint32_t hops_offset) {
+    // vectors of scalars are copied as raw bytes
+    auto coords = entity->coordinates();
+    auto data = entity->data();
+    return CreateEntity(fbb,
+            fbb.CreateString(entity->name()),                                 // name
+            coords ? fbb.CreateVector(coords->data(), coords->size()) : 0,    // coordinates
+            entity->filter(),                                                 // filter
+            entity->hop_limit(),                                              // hop limit
+            entity->range(),                                                  // range
+            entity->expiry(),                                                 // expiry
+            data ? fbb.CreateVector(data->data(), data->size()) : 0,          // data
+            timestamp_offset,                                                 // timestamp offset
+            hops_offset                                                       // hops offset
+    );
+}
+
+void EgoSphere::receiveEntityUpdatesBatch(std::vector<const Entity*>& forward_entities,
+        std::vector<size_t>& forward_counts, const Message* const* msgs, size_t n_msgs,
+        const PeerTracker& peer_tracker, int64_t current_time) {
+    forward_entities.clear();
+    forward_counts.clear();
+    for (size_t i = 0; i < n_msgs; ++i) {
+        const size_t n_forwarded = forward_entities.size();
+        appendEntityUpdates(forward_entities, msgs[i], peer_tracker, current_time);
+        forward_counts.push_back(forward_entities.size() - n_forwarded);
+    }
+}
+
+void EgoSphere::appendEntityUpdates(std::vector<const Entity*>& forward_entities,
+        const Message* msg, const PeerTracker& peer_tracker, int64_t current_time) {
     // input checks
     if (!msg || !msg->entities()) {
-        return forward_entities;
+        return;
     }
     if (!msg->source() || !msg->source()->address()) {
         IF_PTR(_logger, log, Logger::WARN, Error{STRERR(MESSAGE_SOURCE_INVALID)}, msg);
-        return forward_entities;
+        return;
     }
     if (!(msg->source()->group_mask() & peer_tracker.getNodeInfo().group_mask)) {
         IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(SOURCE_GROUP_MISMATCH)}, msg);
-        return forward_entities;
+        return;
     }
-    // unpack message source
-    NodeInfoT source;
-    msg->source()->UnPackTo(&source);
+    // unpack message source into reused storage, absent fields are reset
+    auto& source = _source;
+    source.name.clear();
+    source.coordinates.clear();
+    unpackNodeInfo(msg->source(), source);
     bool from_self = source.address == peer_tracker.getNodeInfo().address;
     // iterate through entities
     for (auto entity : *msg->entities()) {
@@ -35,30 +71,30 @@ std::vector<fb::Offset<Entity>> EgoSphere::receiveEntityUpdates(fb::FlatBufferBu
             IF_PTR(_logger, log, Logger::WARN, Error{STRERR(ENTITY_NAME_MISSING)}, entity);
             continue;
         }
-        std::string name = entity->name()->str();
         // reject if entity timestamp was already received
-        if (_timestamps.count({name, msg->timestamp()})) {
+        const int64_t timestamp = entityTimestamp(msg, entity);
+        const auto fingerprint = DedupCache::fingerprint(
+                entity->name()->c_str(), entity->name()->size(), timestamp);
+        if (_timestamps.contains(fingerprint)) {
             IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(ENTITY_ALREADY_RECEIVED)}, entity);
             continue;
         }
         // find previous record of entity
-        auto old_entity = _entities.find(name);
+        auto old_entity = findEntity(entity->name()->c_str(), entity->name()->size());
         // don't filter if from self, otherwise use filter of original entity if it exists
-        Filter filter = from_self
-                                ? Filter::ALL
-                                : old_entity == _entities.end() ? entity->filter()
-                                                                : old_entity->second.entity.filter;
+        Filter filter = from_self ? Filter::ALL
+                                  : !old_entity ? entity->filter()
+                                                : old_entity->second.entity->filter();
         // nearest filter rejection
         if (filter == Filter::NEAREST) {
-            const auto& nearest_peer =
-                    old_entity == _entities.end()
-                            ? peer_tracker.nearestPeer(*entity->coordinates(), connected_peers)
-                            : peer_tracker.nearestPeer(
-                                      old_entity->second.entity.coordinates, connected_peers);
+            const auto coordinates = !old_entity ? entity->coordinates()
+                                                 : old_entity->second.entity->coordinates();
+            const auto& nearest_peer = coordinates ? peer_tracker.nearestPeer(*coordinates)
+                                                   : peer_tracker.getNodeInfo();
             // only allow entity update if source is from its nearest peer
             if (nearest_peer.address != source.address &&
                     // unless it's a suggestion for a new entity nearest to you
-                    !(old_entity == _entities.end() &&
+                    !(!old_entity &&
                             nearest_peer.address == peer_tracker.getNodeInfo().address)) {
                 Error error{STRERR(ENTITY_NEAREST_FILTERED)};
                 IF_PTR(_logger, log, Logger::TRACE, error, entity);
@@ -66,14 +102,13 @@ std::vector<fb::Offset<Entity>> EgoSphere::receiveEntityUpdates(fb::FlatBufferBu
             }
         }
         // insert entity timestamp once filter passes
-        insertEntityTimestamp(name, msg->timestamp());
+        insertEntityTimestamp(fingerprint);
         // create lambda for delete and forward operation
         const auto delete_and_forward_if_exists = [&]() {
             // if entity exists, delete entity and forward message
-            if (deleteEntity(name, source)) {
-                EntityT entity_obj;
-                entity->UnPackTo(&entity_obj);
-                forward_entities.emplace_back(Entity::Pack(fbb, &entity_obj));
+            if (old_entity) {
+                deleteEntity(old_entity, source);
+                forward_entities.emplace_back(entity);
             }
         };
         // check if entity already expired
@@ -90,73 +125,205 @@ std::vector<fb::Offset<Entity>> EgoSphere::receiveEntityUpdates(fb::FlatBufferBu
             IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(ENTITY_RANGE_EXCEEDED)}, entity);
             continue;
         }
-        // checks pass, proceed to update entity
-        EntityUpdate new_entity{{}, current_time, msg->timestamp(), msg->hops()};
-        entity->UnPackTo(&new_entity.entity);
+        // checks pass, copy entity into a compact buffer without unpacking
+        const uint32_t hops = entityHops(msg, entity);
+        _entity_fbb.Clear();
+        _entity_fbb.Finish(copyEntity(_entity_fbb, entity, 0, 0));
+        _new_entity.entity.assign(_entity_fbb.GetBufferPointer(), _entity_fbb.GetSize());
+        _new_entity.receive_timestamp = current_time;
+        _new_entity.source_timestamp = timestamp;
+        _new_entity.hops = hops;
+        _new_entity.lod_timestamp = std::numeric_limits<int64_t>::min();
         // reject update if handler returns false
         if (_entity_update_handler &&
-                !_entity_update_handler(&new_entity,
-                        old_entity == _entities.end() ? nullptr : &old_entity->second, source)) {
+                !_entity_update_handler(&_new_entity,
+                        old_entity ? &old_entity->second : nullptr, source)) {
             continue;
         }
         // update entity in storage only if expiry exists
         if (entity->expiry()) {
-            if (old_entity == _entities.end()) {
-                old_entity = _entities.emplace(name, std::move(new_entity)).first;
+            if (!old_entity) {
+                // name is only copied when a new entity is stored
+                std::string name(entity->name()->c_str(), entity->name()->size());
+                auto& stored = *_entities.emplace(std::move(name), std::move(_new_entity)).first;
+                const auto id = _names.intern(stored.first);
+                if (id >= _entities_by_id.size()) {
+                    _entities_by_id.resize(_names.idBound(), nullptr);
+                }
+                _entities_by_id[id] = &stored;
+                markDirty(stored.first);
+                pushExpiry(&stored);
+                _spatial_index.insert(&stored, stored.second.entity->coordinates());
                 IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_CREATED)}, entity);
             } else {
-                old_entity->second = std::move(new_entity);
+                // swap buffers so the replaced one gets recycled by the next update
+                auto& stored = old_entity->second;
+                markDirty(old_entity->first);
+                _spatial_index.update(old_entity, stored.entity->coordinates(),
+                        _new_entity.entity->coordinates());
+                std::swap(stored.entity, _new_entity.entity);
+                stored.receive_timestamp = _new_entity.receive_timestamp;
+                stored.source_timestamp = _new_entity.source_timestamp;
+                stored.hops = _new_entity.hops;
+                updateExpiry(stored.expiry_index, entity->expiry());
                 IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(ENTITY_UPDATED)}, entity);
             }
         }
         // forward entity until hop limit is reached
-        if (!entity->hop_limit() || entity->hop_limit() > msg->hops()) {
-            forward_entities.emplace_back(Entity::Pack(fbb, &old_entity->second.entity));
+        if (!entity->hop_limit() || entity->hop_limit() > hops) {
+            forward_entities.emplace_back(entity);
         } else {
             IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(ENTITY_HOPS_EXCEEDED)}, entity);
         }
     }
-    return forward_entities;
+}
+
+bool EgoSphere::lodUpdateDue(
+        const Entity* entity, int64_t current_time, int64_t interval) const {
+    auto stored = entity->name() ? findEntity(entity->name()->c_str(), entity->name()->size())
+                                 : nullptr;
+    // min timestamp means no update was sent yet, avoids overflow of the subtraction
+    return !stored || stored->second.lod_timestamp == std::numeric_limits<int64_t>::min() ||
+           current_time - stored->second.lod_timestamp >= interval;
+}
+
+void EgoSphere::markLodUpdate(const Entity* entity, int64_t current_time) {
+    auto stored = entity->name() ? findEntity(entity->name()->c_str(), entity->name()->size())
+                                 : nullptr;
+    if (stored) {
+        stored->second.lod_timestamp = current_time;
+    }
 }
 
 bool EgoSphere::deleteEntity(const std::string& name, const NodeInfoT& source) {
-    auto entity = _entities.find(name);
-    if (entity == _entities.end()) {
+    auto entity = findEntity(name.data(), name.size());
+    if (!entity) {
         return false;
     }
+    deleteEntity(entity, source);
+    return true;
+}
+
+void EgoSphere::deleteEntity(EntityLookup::value_type* entity, const NodeInfoT& source) {
     if (_entity_update_handler) {
         _entity_update_handler(nullptr, &entity->second, source);
     }
     IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_DELETED)}, &entity->second);
-    _entities.erase(entity);
-    return true;
+    eraseEntity(entity);
 }
 
 void EgoSphere::expireEntities(int64_t current_time, const NodeInfoT& source) {
-    for (auto entity = _entities.begin(); entity != _entities.end();) {
-        if (entity->second.entity.expiry <= current_time) {
-            if (_entity_update_handler) {
-                _entity_update_handler(nullptr, &entity->second, source);
+    // only entities at the top of the heap are visited
+    while (!_expiry_heap.empty() && _expiry_heap.front().first <= current_time) {
+        auto entity = _expiry_heap.front().second;
+        if (_entity_update_handler) {
+            _entity_update_handler(nullptr, &entity->second, source);
+        }
+        IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_EXPIRED)}, &entity->second);
+        eraseEntity(entity);
+    }
+}
+
+void EgoSphere::eraseEntity(EntityLookup::value_type* entity) {
+    markDirty(entity->first);
+    eraseExpiry(entity->second.expiry_index);
+    _spatial_index.erase(entity, entity->second.entity->coordinates());
+    const auto id = _names.find(entity->first);
+    _entities_by_id[id] = nullptr;
+    _names.release(id);
+    _entities.erase(_entities.find(entity->first));
+}
+
+void EgoSphere::publishSnapshot() {
+    if (!_config.entity_snapshots || _dirty.empty()) {
+        return;
+    }
+    // recycle the previous snapshot once no readers hold it, otherwise start from a full copy
+    if (_back_snapshot && _back_snapshot.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // previous snapshot is missing changes from both its own batch and the current one
+        const auto sync_entity = [this](const std::string& name) {
+            auto entity = findEntity(name.data(), name.size());
+            if (!entity) {
+                _back_snapshot->erase(name);
+            } else {
+                (*_back_snapshot)[name] = entity->second;
             }
-            IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_EXPIRED)}, &entity->second);
-            entity = _entities.erase(entity);
-        } else {
-            ++entity;
+        };
+        for (const auto& name : _back_dirty) {
+            if (!_dirty.count(name)) {
+                sync_entity(name);
+            }
+        }
+        for (const auto& name : _dirty) {
+            sync_entity(name);
         }
+    } else {
+        _back_snapshot = std::make_shared<EntityLookup>(_entities);
     }
+    // swap front and back
+    EntitySnapshot front(std::move(_back_snapshot));
+    _back_snapshot = std::const_pointer_cast<EntityLookup>(
+            std::atomic_exchange(&_snapshot, std::move(front)));
+    _back_dirty.swap(_dirty);
+    _dirty.clear();
 }
 
-bool EgoSphere::insertEntityTimestamp(std::string name, int64_t timestamp) {
-    if (!_timestamps.insert({std::move(name), timestamp}).second) {
+bool EgoSphere::insertEntityTimestamp(uint64_t fingerprint) {
+    if (!_timestamps.insert(fingerprint)) {
         return false;
     }
-    // clear half of the lookup table when full
-    if (_timestamps.size() > _config.timestamp_lookup_size) {
-        _timestamps.erase(
-                _timestamps.begin(), std::next(_timestamps.begin(), _timestamps.size() / 2));
+    // oldest timestamps are evicted one at a time when full, log once per full turnover
+    auto evictions = _timestamps.getStats().evictions;
+    if (evictions && evictions % _timestamps.capacity() == 0) {
         IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_TIMESTAMPS_TRIMMED)});
     }
     return true;
 }
 
+void EgoSphere::pushExpiry(EntityLookup::value_type* entity) {
+    entity->second.expiry_index = _expiry_heap.size();
+    _expiry_heap.emplace_back(entity->second.entity->expiry(), entity);
+    siftExpiry(_expiry_heap.size() - 1);
+}
+
+void EgoSphere::updateExpiry(size_t index, int64_t expiry) {
+    _expiry_heap[index].first = expiry;
+    siftExpiry(index);
+}
+
+void EgoSphere::eraseExpiry(size_t index) {
+    swapExpiry(index, _expiry_heap.size() - 1);
+    _expiry_heap.pop_back();
+    if (index < _expiry_heap.size()) {
+        siftExpiry(index);
+    }
+}
+
+void EgoSphere::siftExpiry(size_t index) {
+    // sift up
+    while (index > 0 && _expiry_heap[index].first < _expiry_heap[(index - 1) / 2].first) {
+        swapExpiry(index, (index - 1) / 2);
+        index = (index - 1) / 2;
+    }
+    // sift down
+    for (size_t child = 2 * index + 1; child < _expiry_heap.size(); child = 2 * index + 1) {
+        if (child + 1 < _expiry_heap.size() &&
+                _expiry_heap[child + 1].first < _expiry_heap[child].first) {
+            ++child;
+        }
+        if (!(_expiry_heap[child].first < _expiry_heap[index].first)) {
+            break;
+        }
+        swapExpiry(index, child);
+        index = child;
+    }
+}
+
+void EgoSphere::swapExpiry(size_t a, size_t b) {
+    std::swap(_expiry_heap[a], _expiry_heap[b]);
+    _expiry_heap[a].second->second.expiry_index = a;
+    _expiry_heap[b].second->second.expiry_index = b;
+}
+
 }  // namespace vsm
@@ -0,0 +1,283 @@
+#include <vsm/inproc_transport.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+namespace vsm {
+
+static constexpr int64_t NS_PER_MS = 1000000;
+
+InProcNetwork::InProcNetwork()
+        : InProcNetwork(Config()) {}
+
+InProcNetwork::InProcNetwork(Config config)
+        : _config(std::move(config))
+        , _random(_config.seed) {}
+
+size_t InProcNetwork::run(size_t duration_ms) {
+    const int64_t deadline = getTime() + static_cast<int64_t>(duration_ms) * NS_PER_MS;
+    size_t n_events = 0;
+    while (runNext(deadline)) {
+        ++n_events;
+    }
+    advanceTime(deadline);
+    return n_events;
+}
+
+bool InProcNetwork::step() {
+    return runNext(std::numeric_limits<int64_t>::max());
+}
+
+size_t InProcNetwork::pendingEvents() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _events.size();
+}
+
+uint32_t InProcNetwork::addTransport(InProcTransport* transport) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    const auto id = static_cast<uint32_t>(_transports.size());
+    if (!_transport_ids.emplace(transport->getAddress(), id).second) {
+        throw std::system_error(EADDRINUSE, std::generic_category(),
+                std::string("InProcTransport ") + transport->getAddress());
+    }
+    _transports.push_back(transport);
+    return id;
+}
+
+void InProcNetwork::removeTransport(uint32_t transport_id) {
+    // pending events of a removed transport are dropped when they come up
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _transport_ids.erase(_transports[transport_id]->getAddress());
+    _transports[transport_id] = nullptr;
+}
+
+void InProcNetwork::pushEvent(int64_t time, uint32_t transport_id, int timer_id,
+        std::shared_ptr<const Packet> packet) {
+    _events.push_back(Event{time, _sequence++, transport_id, timer_id, std::move(packet)});
+    std::push_heap(_events.begin(), _events.end());
+}
+
+bool InProcNetwork::runNext(int64_t deadline) {
+    Event event;
+    InProcTransport* transport;
+    {
+        const std::lock_guard<std::mutex> lock(_mutex);
+        if (_events.empty() || _events.front().time > deadline) {
+            return false;
+        }
+        std::pop_heap(_events.begin(), _events.end());
+        event = std::move(_events.back());
+        _events.pop_back();
+        if (event.time > getTime()) {
+            _time.store(event.time, std::memory_order_relaxed);
+        }
+        transport = _transports[event.transport_id];
+        if (!transport) {
+            return true;
+        }
+        // timers are rescheduled up front so the callback sees the next expiry pending
+        if (event.timer_id) {
+            pushEvent(event.time + transport->_timers[event.timer_id - 1].first,
+                    event.transport_id, event.timer_id);
+        }
+    }
+    // dispatch outside the lock so callbacks can transmit
+    const auto start = std::chrono::steady_clock::now();
+    if (event.timer_id) {
+        transport->_timers[event.timer_id - 1].second(event.timer_id);
+    } else {
+        auto receiver_callback = transport->_receiver_callbacks.find(event.packet->group);
+        if (receiver_callback != transport->_receiver_callbacks.end()) {
+            receiver_callback->second(event.packet->buffer, event.packet->len);
+        }
+        // burst ends unless the next event is another message to this transport at this time
+        bool burst_end;
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            burst_end = _events.empty() || _events.front().time != event.time ||
+                        _events.front().transport_id != event.transport_id ||
+                        _events.front().timer_id;
+        }
+        if (burst_end) {
+            for (auto& burst_callback : transport->_burst_callbacks) {
+                burst_callback();
+            }
+        }
+    }
+    const auto cpu_time = std::chrono::steady_clock::now() - start;
+    const std::lock_guard<std::mutex> lock(_mutex);
+    auto& stats = transport->_stats;
+    stats.cpu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(cpu_time).count();
+    if (!event.timer_id) {
+        ++stats.rx_messages;
+        stats.rx_bytes += event.packet->len;
+    }
+    return true;
+}
+
+void InProcNetwork::advanceTime(int64_t time) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (time > getTime()) {
+        _time.store(time, std::memory_order_relaxed);
+    }
+}
+
+InProcTransport::InProcTransport(std::shared_ptr<InProcNetwork> network, std::string address)
+        : _network(std::move(network))
+        , _address(std::move(address))
+        , _id(_network->addTransport(this)) {}
+
+InProcTransport::~InProcTransport() {
+    _network->removeTransport(_id);
+}
+
+int InProcTransport::connect(const char* dst_addr) {
+    const std::lock_guard<std::mutex> lock(_network->_mutex);
+    _destinations.emplace(dst_addr);
+    return 0;
+}
+
+int InProcTransport::disconnect(const char* dst_addr) {
+    const std::lock_guard<std::mutex> lock(_network->_mutex);
+    return _destinations.erase(dst_addr) ? 0 : -1;
+}
+
+int InProcTransport::transmitTo(const void* buffer, size_t len,
+        const std::vector<std::string>& dst_addrs, const char* group) {
+    auto packet = std::make_shared<InProcNetwork::Packet>();
+    auto bytes = static_cast<const uint8_t*>(buffer);
+    packet->copy.assign(bytes, bytes + len);
+    return transmitPacket(std::move(packet), group, &dst_addrs, nullptr);
+}
+
+int InProcTransport::transmitExcept(
+        const void* buffer, size_t len, const char* exclude_addr, const char* group) {
+    auto packet = std::make_shared<InProcNetwork::Packet>();
+    auto bytes = static_cast<const uint8_t*>(buffer);
+    packet->copy.assign(bytes, bytes + len);
+    return transmitPacket(std::move(packet), group, nullptr, exclude_addr);
+}
+
+int InProcTransport::transmitTo(void* buffer, size_t len, ReleaseCallback release, void* hint,
+        const std::vector<std::string>& dst_addrs, const char* group) {
+    auto packet = std::make_shared<InProcNetwork::Packet>();
+    packet->buffer = buffer;
+    packet->len = len;
+    packet->release = release;
+    packet->hint = hint;
+    return transmitPacket(std::move(packet), group, &dst_addrs, nullptr);
+}
+
+int InProcTransport::transmitExcept(void* buffer, size_t len, ReleaseCallback release,
+        void* hint, const char* exclude_addr, const char* group) {
+    auto packet = std::make_shared<InProcNetwork::Packet>();
+    packet->buffer = buffer;
+    packet->len = len;
+    packet->release = release;
+    packet->hint = hint;
+    return transmitPacket(std::move(packet), group, nullptr, exclude_addr);
+}
+
+int InProcTransport::transmitPacket(std::shared_ptr<InProcNetwork::Packet> packet,
+        const char* group, const std::vector<std::string>* dst_addrs, const char* exclude_addr) {
+    packet->group = group;
+    if (!packet->buffer) {
+        packet->buffer = packet->copy.data();
+        packet->len = packet->copy.size();
+    }
+    const std::lock_guard<std::mutex> lock(_network->_mutex);
+    if (dst_addrs) {
+        for (const auto& dst_addr : *dst_addrs) {
+            if (_destinations.count(dst_addr)) {
+                sendTo(dst_addr, packet);
+            }
+        }
+    } else {
+        for (const auto& dst_addr : _destinations) {
+            if (!exclude_addr || std::strcmp(dst_addr.c_str(), exclude_addr)) {
+                sendTo(dst_addr, packet);
+            }
+        }
+    }
+    return static_cast<int>(packet->len);
+}
+
+void InProcTransport::sendTo(
+        const std::string& dst_addr, const std::shared_ptr<InProcNetwork::Packet>& packet) {
+    auto& network = *_network;
+    const auto& config = network._config;
+    ++_stats.tx_messages;
+    _stats.tx_bytes += packet->len;
+    // messages queue up behind each other on a limited uplink
+    int64_t send_time = network.getTime();
+    if (config.bandwidth_kbps > 0) {
+        send_time = std::max(send_time, _uplink_free_time) +
+                    static_cast<int64_t>(packet->len * 8 * NS_PER_MS / config.bandwidth_kbps);
+        _uplink_free_time = send_time;
+    }
+    std::uniform_real_distribution<float> uniform(0, 1);
+    auto dst_id = network._transport_ids.find(dst_addr);
+    if (dst_id == network._transport_ids.end() ||
+            (config.loss > 0 && uniform(network._random) < config.loss)) {
+        ++_stats.dropped_messages;
+        return;
+    }
+    float delay_ms = config.latency_ms;
+    if (config.jitter_ms > 0) {
+        delay_ms += config.jitter_ms * uniform(network._random);
+    }
+    network.pushEvent(send_time + static_cast<int64_t>(delay_ms * NS_PER_MS), dst_id->second, 0,
+            packet);
+}
+
+int InProcTransport::addReceiver(ReceiverCallback receiver_callback, const char* group) {
+    _receiver_callbacks[group] = std::move(receiver_callback);
+    return 0;
+}
+
+int InProcTransport::addTimer(size_t interval_ms, TimerCallback timer_callback) {
+    const std::lock_guard<std::mutex> lock(_network->_mutex);
+    const int64_t interval = static_cast<int64_t>(std::max<size_t>(interval_ms, 1)) * NS_PER_MS;
+    _timers.emplace_back(interval, std::move(timer_callback));
+    const int timer_id = static_cast<int>(_timers.size());
+    _network->pushEvent(_network->getTime() + interval, _id, timer_id);
+    return timer_id;
+}
+
+int InProcTransport::addBurstCallback(BurstCallback burst_callback) {
+    _burst_callbacks.emplace_back(std::move(burst_callback));
+    return 0;
+}
+
+int InProcTransport::poll(size_t timeout_ms) {
+    auto& network = *_network;
+    // an infinite timeout only runs events that are already scheduled
+    const bool infinite = timeout_ms == static_cast<size_t>(-1);
+    const int64_t deadline = infinite ? std::numeric_limits<int64_t>::max()
+                                      : network.getTime() +
+                                                static_cast<int64_t>(timeout_ms) * NS_PER_MS;
+    const auto rx_messages = getStats().rx_messages;
+    while (getStats().rx_messages == rx_messages && network.runNext(deadline)) {
+    }
+    if (getStats().rx_messages == rx_messages) {
+        if (!infinite) {
+            network.advanceTime(deadline);
+        }
+        return EAGAIN;
+    }
+    // drain other messages arriving at the same time
+    while (network.runNext(network.getTime())) {
+    }
+    return 0;
+}
+
+InProcNetwork::Stats InProcTransport::getStats() const {
+    const std::lock_guard<std::mutex> lock(_network->_mutex);
+    return _stats;
+}
+
+}  // namespace vsm
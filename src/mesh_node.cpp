@@ -1,17 +1,47 @@
 #include <vsm/mesh_node.hpp>
 #include <vsm/time_sync.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
 namespace vsm {
 
 using namespace flatbuffers;
 
+// idle pipeline stages spin briefly then sleep so they don't hog a core
+static void backoff(size_t& idle_count) {
+    if (++idle_count < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
 MeshNode::MeshNode(Config config)
         : _ego_sphere(std::move(config.ego_sphere), config.logger)
         , _peer_tracker(std::move(config.peer_tracker), config.logger)
         , _time_sync(std::move(config.local_clock))
         , _transport(std::move(config.transport))
         , _logger(std::move(config.logger))
+        , _buffer_pool(std::make_shared<BufferPool>(config.buffer_pool_size))
+        // builders are sized to fit a full batch of entity updates up front
+        , _fbb(2 * config.entity_updates_size, _buffer_pool.get())
+        , _update_fbb_in(2 * config.entity_updates_size, _buffer_pool.get())
+        , _update_fbb_out(2 * config.entity_updates_size, _buffer_pool.get())
+        , _submit_queue(config.submit_queue_size > 0
+                                ? new MpscQueue<EntityT>(config.submit_queue_size)
+                                : nullptr)
         , _entity_updates_size(config.entity_updates_size)
+        , _receive_batch_size(config.receive_batch_size)
+        , _merge_forwards(config.merge_forwards)
+        , _lod_distance(config.lod_distance)
+        , _lod_interval(
+                  std::chrono::nanoseconds(std::chrono::milliseconds(config.lod_interval_ms))
+                          .count())
+        , _forward_coalesce(config.forward_coalesce_ms > 0)
+        , _update_coalesce(config.update_coalesce_ms > 0)
         , _spectator(config.spectator) {
     if (!_transport) {
         Error error{STRERR(NO_TRANSPORT_SPECIFIED)};
@@ -25,25 +55,101 @@ MeshNode::MeshNode(Config config)
         IF_PTR(_logger, log, Logger::ERROR, error);
         throw error;
     }
-    // register peer update timer
-    if (0 > _transport->addTimer(
-                    config.peer_update_interval_ms, [this](int) { sendPeerUpdates(); })) {
+    // without a pipeline, bursts are collected on the polling thread until the transport reports
+    // their end, each message is applied on its own if it can't
+    if (_receive_batch_size > 1 && config.pipeline_workers == 0 &&
+            _transport->addBurstCallback([this]() { applyBurst(); }) < 0) {
+        _receive_batch_size = 0;
+    }
+    // register peer update timer, applied in order with received messages when pipelined
+    if (0 > _transport->addTimer(config.peer_update_interval_ms, [this](int) {
+            if (_pipeline_workers.empty()) {
+                sendPeerUpdates();
+            } else {
+                pushPipeline(PipelineItem::PEER_UPDATE, nullptr, 0, true);
+            }
+        })) {
         Error error{STRERR(ADD_TIMER_FAIL)};
         IF_PTR(_logger, log, Logger::ERROR, error);
         throw error;
     }
     // register entity expiry timer
     if (0 > _transport->addTimer(config.entity_expiry_interval_ms, [this](int) {
-            const std::lock_guard<std::mutex> lock(_entities_mutex);
-            _ego_sphere.expireEntities(_time_sync.getTime(), _peer_tracker.getNodeInfo());
+            if (_pipeline_workers.empty()) {
+                expireEntities();
+            } else {
+                pushPipeline(PipelineItem::ENTITY_EXPIRY, nullptr, 0, true);
+            }
         })) {
         Error error{STRERR(ADD_TIMER_FAIL)};
         IF_PTR(_logger, log, Logger::ERROR, error);
         throw error;
     }
+    // register coalesced forwards flush timer
+    if (_forward_coalesce && 0 > _transport->addTimer(config.forward_coalesce_ms, [this](int) {
+            if (_pipeline_workers.empty()) {
+                flushForwards();
+            } else {
+                pushPipeline(PipelineItem::FORWARD_FLUSH, nullptr, 0, true);
+            }
+        })) {
+        Error error{STRERR(ADD_TIMER_FAIL)};
+        IF_PTR(_logger, log, Logger::ERROR, error);
+        throw error;
+    }
+    // register staged entity updates flush timer
+    if (_update_coalesce && 0 > _transport->addTimer(config.update_coalesce_ms, [this](int) {
+            if (_pipeline_workers.empty()) {
+                flushEntityUpdates();
+            } else {
+                pushPipeline(PipelineItem::ENTITY_FLUSH, nullptr, 0, true);
+            }
+        })) {
+        Error error{STRERR(ADD_TIMER_FAIL)};
+        IF_PTR(_logger, log, Logger::ERROR, error);
+        throw error;
+    }
+    // register submitted entities timer, producers never touch the transport themselves
+    if (_submit_queue && 0 > _transport->addTimer(config.submit_interval_ms, [this](int) {
+            if (_pipeline_workers.empty()) {
+                sendSubmittedEntities();
+            } else {
+                pushPipeline(PipelineItem::ENTITY_SUBMIT, nullptr, 0, true);
+            }
+        })) {
+        Error error{STRERR(ADD_TIMER_FAIL)};
+        IF_PTR(_logger, log, Logger::ERROR, error);
+        throw error;
+    }
+    // start pipeline threads
+    if (config.pipeline_workers > 0) {
+        _pipeline_running = true;
+        for (size_t i = 0; i < config.pipeline_workers; ++i) {
+            _pipeline_workers.emplace_back(new PipelineWorker(config.pipeline_queue_size));
+        }
+        const auto self_address = _peer_tracker.getNodeInfo().address;
+        for (auto& worker : _pipeline_workers) {
+            auto worker_ptr = worker.get();
+            worker->thread = std::thread([this, worker_ptr, self_address]() {
+                runPipelineWorker(*worker_ptr, self_address);
+            });
+        }
+        _pipeline_apply_thread = std::thread([this]() { runPipelineApply(); });
+    }
     IF_PTR(_logger, log, Logger::INFO, Error{STRERR(MeshNode::INITIALIZED)});
 }
 
+MeshNode::~MeshNode() {
+    // unapplied items are dropped
+    _pipeline_running = false;
+    for (auto& worker : _pipeline_workers) {
+        worker->thread.join();
+    }
+    if (_pipeline_apply_thread.joinable()) {
+        _pipeline_apply_thread.join();
+    }
+}
+
 void MeshNode::offsetRelativeExpiry(std::vector<EntityT>& entities) const {
     // increment expiry of each entity by current time
     int64_t current_time = _time_sync.getTime();
@@ -53,78 +159,268 @@ void MeshNode::offsetRelativeExpiry(std::vector<EntityT>& entities) const {
 }
 
 std::vector<MessageBuffer> MeshNode::updateEntities(const std::vector<EntityT>& entities) {
+    std::vector<MessageBuffer> forwarded_messages;
+    updateEntities(forwarded_messages, entities);
+    return forwarded_messages;
+}
+
+void MeshNode::updateEntities(
+        std::vector<MessageBuffer>& forwarded_messages, const std::vector<EntityT>& entities) {
+    forwarded_messages.clear();
     if (entities.empty()) {
-        return {};
+        return;
+    }
+    const std::lock_guard<std::mutex> lock(_update_mutex);
+    if (!_update_coalesce) {
+        sendEntityUpdates(forwarded_messages, entities.data(), entities.size());
+        return;
+    }
+    stageEntities(entities.data(), entities.size());
+}
+
+void MeshNode::stageEntities(const EntityT* entities, size_t n_entities) {
+    // stage entities until the next flush, a later update of the same name overwrites in place
+    for (size_t i = 0; i < n_entities; ++i) {
+        const auto name_id = _staged_names.intern(entities[i].name);
+        if (name_id == _staged_entities.size()) {
+            _staged_entities.emplace_back();
+        }
+        _staged_entities[name_id] = entities[i];
+    }
+}
+
+size_t MeshNode::submitEntities(const std::vector<EntityT>& entities) {
+    size_t n_submitted = 0;
+    if (!_submit_queue) {
+        return n_submitted;
+    }
+    for (const auto& entity : entities) {
+        if (!_submit_queue->push(entity)) {
+            // producers don't log, the logger is only used by the polling thread
+            _submit_drops.fetch_add(entities.size() - n_submitted, std::memory_order_relaxed);
+            break;
+        }
+        ++n_submitted;
+    }
+    return n_submitted;
+}
+
+void MeshNode::sendSubmittedEntities() {
+    // data holds how many entities were dropped since the last report
+    const size_t n_dropped = _submit_drops.exchange(0, std::memory_order_relaxed);
+    if (n_dropped) {
+        IF_PTR(_logger, log, Logger::WARN, Error{STRERR(SUBMIT_QUEUE_FULL)}, &n_dropped,
+                sizeof(n_dropped));
+    }
+    // only take what is queued now so busy producers can't keep the polling thread here
+    size_t n_entities = std::min(_submit_queue->size(), _submit_queue->capacity());
+    if (_submitted_entities.size() < n_entities) {
+        _submitted_entities.resize(n_entities);
+    }
+    size_t n_popped = 0;
+    for (EntityT* entity; n_popped < n_entities && (entity = _submit_queue->front()); ++n_popped) {
+        std::swap(_submitted_entities[n_popped], *entity);
+        _submit_queue->pop();
+    }
+    if (n_popped == 0) {
+        return;
     }
+    const std::lock_guard<std::mutex> lock(_update_mutex);
+    if (_update_coalesce) {
+        stageEntities(_submitted_entities.data(), n_popped);
+    } else {
+        sendEntityUpdates(_submitted_messages, _submitted_entities.data(), n_popped);
+        _submitted_messages.clear();
+    }
+}
+
+void MeshNode::flushEntityUpdates() {
+    const std::lock_guard<std::mutex> lock(_update_mutex);
+    if (_staged_names.size() == 0) {
+        return;
+    }
+    sendEntityUpdates(_staged_messages, _staged_entities.data(), _staged_names.size());
+    // staged entities keep their storage for the next round
+    _staged_names.clear();
+    _staged_messages.clear();
+}
+
+void MeshNode::sendEntityUpdates(std::vector<MessageBuffer>& forwarded_messages,
+        const EntityT* entities, size_t n_entities) {
     // write message in
-    fb::FlatBufferBuilder fbb_in, fbb_out;
-    std::vector<MessageBuffer> forwarded_messages;
-    std::vector<fb::Offset<Entity>> entity_offsets;
+    auto& fbb_in = _update_fbb_in;
+    auto& fbb_out = _update_fbb_out;
+    auto& entity_offsets = _update_offsets;
     // lambda function to process a batch of entities to be updated
     const auto update_entities = [&]() {
         // create the flat buffers message
         fbb_in.Finish(CreateMessage(fbb_in,
                 _time_sync.getTime(),                                  // timestamp
                 0,                                                     // hops
-                NodeInfo::Pack(fbb_in, &_peer_tracker.getNodeInfo()),  // source
+                _peer_tracker.copyNodeInfo(fbb_in),                    // source
                 {},                                                    // peers
                 fbb_in.CreateVector(entity_offsets)                    // entities
                 ));
         auto msg = GetRoot<Message>(fbb_in.GetBufferPointer());
         // process entities in ego_sphere and forward updates to peers
-        if (forwardEntityUpdates(fbb_out, msg)) {
-            forwarded_messages.emplace_back(std::move(fbb_out.Release()));
+        if (forwardEntityUpdates(fbb_out, _update_context, msg, fbb_in.GetBufferPointer(),
+                    fbb_in.GetSize(), false)) {
+            forwarded_messages.emplace_back(fbb_out.Release(), _buffer_pool);
         }
-        fbb_in.Reset();
-        fbb_out.Reset();
+        // clear keeps the input buffer, released output buffers are recycled through the pool
+        fbb_in.Clear();
+        fbb_out.Clear();
         entity_offsets.clear();
     };
     // split up messages when  entity updates size is exceeded
-    for (const auto& entity : entities) {
-        entity_offsets.emplace_back(Entity::Pack(fbb_in, &entity));
+    for (size_t i = 0; i < n_entities; ++i) {
+        entity_offsets.emplace_back(Entity::Pack(fbb_in, &entities[i]));
         if (fbb_in.GetSize() >= _entity_updates_size) {
             update_entities();
         }
     }
     update_entities();
     IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_UPDATES_SENT)});
-    return forwarded_messages;
 }
 
 const Message* MeshNode::forwardEntityUpdates(fb::FlatBufferBuilder& fbb, const Message* msg) {
+    ForwardContext context;
+    return forwardEntityUpdates(fbb, context, msg, nullptr, 0, false)
+                   ? GetRoot<Message>(fbb.GetBufferPointer())
+                   : nullptr;
+}
+
+const Message* MeshNode::forwardEntityUpdates(
+        fb::FlatBufferBuilder& fbb, const void* buffer, size_t len) {
+    ForwardContext context;
+    return forwardEntityUpdates(fbb, context, GetRoot<Message>(buffer), buffer, len, false)
+                   ? GetRoot<Message>(fbb.GetBufferPointer())
+                   : nullptr;
+}
+
+bool MeshNode::forwardEntityUpdates(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+        const Message* msg, const void* buffer, size_t len, bool release_buffer) {
     fbb.Clear();
-    std::vector<fb::Offset<Entity>> forward_entities;
+    auto& forward_entities = context.entities;
+    auto& entries = context.entries;
+    entries.clear();
+    // don't send message back to the original source
+    const char* src_addr =
+            msg->source() && msg->source()->address() ? msg->source()->address()->c_str() : nullptr;
+    const bool coalesce = release_buffer && _forward_coalesce;
+    bool per_peer = false;
     {
         // lock and update ego sphere entities
         const std::lock_guard<std::mutex> lock(_entities_mutex);
-        forward_entities = _ego_sphere.receiveEntityUpdates(
-                fbb, msg, _peer_tracker, _connected_peers, _time_sync.getTime());
+        _ego_sphere.receiveEntityUpdates(
+                forward_entities, msg, _peer_tracker, _time_sync.getTime());
+        _ego_sphere.publishSnapshot();
+        if (!_spectator && (coalesce || _lod_distance > 0)) {
+            for (auto entity : forward_entities) {
+                entries.push_back({entity, entityTimestamp(msg, entity), entityHops(msg, entity),
+                        src_addr});
+            }
+            // decimation is decided against the state the updates were just applied to
+            per_peer = !coalesce && !entries.empty() && applyLevelOfDetail(context, entries);
+        }
     }
     // don't forward updates if spectator
     if (_spectator || forward_entities.empty()) {
-        return nullptr;
-    }
-    // write forward message
-    fbb.Finish(CreateMessage(fbb,
-            msg->timestamp(),                                   // timestamp
-            msg->hops() + 1,                                    // hops
-            NodeInfo::Pack(fbb, &_peer_tracker.getNodeInfo()),  // source
-            {},                                                 // peers
-            fbb.CreateVector(forward_entities)                  // entities
-            ));
-    // don't send message back to the original source
-    const char* src_addr =
-            msg->source() && msg->source()->address() ? msg->source()->address()->c_str() : nullptr;
-    if (src_addr && _transport->disconnect(src_addr)) {
-        src_addr = nullptr;
+        return false;
+    }
+    // received entities are copied and sent once the coalescing window closes
+    if (coalesce) {
+        coalesceForwardEntries(entries);
+        return false;
     }
-    _transport->transmit(fbb.GetBufferPointer(), fbb.GetSize());
-    if (src_addr) {
-        _transport->connect(src_addr);
+    // distant peers get their own messages with decimated entities left out
+    if (per_peer) {
+        transmitPerPeer(fbb, context, entries);
+        return false;
+    }
+    // pass message through when all entities are forwarded, otherwise rebuild with accepted ones
+    if (!buffer || msg->peers() || forward_entities.size() != msg->entities()->size() ||
+            !passThroughMessage(fbb, buffer, len)) {
+        fbb.Clear();
+        auto& entity_offsets = context.offsets;
+        entity_offsets.clear();
+        for (auto entity : forward_entities) {
+            entity_offsets.emplace_back(copyEntity(fbb, entity));
+        }
+        auto entities = fbb.CreateVector(entity_offsets);
+        auto source = _peer_tracker.copyNodeInfo(fbb);
+        // always store hops so the next relay can patch it in place
+        fbb.ForceDefaults(true);
+        fbb.Finish(CreateMessage(fbb,
+                msg->timestamp(),  // timestamp
+                msg->hops() + 1,   // hops
+                source,            // source
+                {},                // peers
+                entities           // entities
+                ));
+        fbb.ForceDefaults(false);
     }
     IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_UPDATES_FORWARDED)},
             fbb.GetBufferPointer(), fbb.GetSize());
-    return GetRoot<Message>(fbb.GetBufferPointer());
+    if (release_buffer) {
+        transmitBuffer(fbb, src_addr);
+    } else {
+        _transport->transmitExcept(fbb.GetBufferPointer(), fbb.GetSize(), src_addr);
+    }
+    return true;
+}
+
+int MeshNode::transmitBuffer(fb::FlatBufferBuilder& fbb, const char* exclude_addr) {
+    // the transport frees the buffer back into the pool once it has been sent
+    auto buffer = new MessageBuffer(fbb.Release(), _buffer_pool);
+    return _transport->transmitExcept(
+            buffer->data(), buffer->size(),
+            [](void*, void* hint) { delete static_cast<MessageBuffer*>(hint); }, buffer,
+            exclude_addr);
+}
+
+int MeshNode::transmitBuffer(
+        fb::FlatBufferBuilder& fbb, const std::vector<std::string>& dst_addrs) {
+    auto buffer = new MessageBuffer(fbb.Release(), _buffer_pool);
+    return _transport->transmitTo(
+            buffer->data(), buffer->size(),
+            [](void*, void* hint) { delete static_cast<MessageBuffer*>(hint); }, buffer,
+            dst_addrs);
+}
+
+// address of a field within a serialized table, null if the field is absent
+static const uint8_t* tableField(const uint8_t* table, voffset_t field) {
+    auto vtable = table - ReadScalar<soffset_t>(table);
+    auto vtable_size = ReadScalar<voffset_t>(vtable);
+    auto offset = field < vtable_size ? ReadScalar<voffset_t>(vtable + field) : 0;
+    return offset ? table + offset : nullptr;
+}
+
+bool MeshNode::passThroughMessage(fb::FlatBufferBuilder& fbb, const void* buffer, size_t len) {
+    auto buf = static_cast<const uint8_t*>(buffer);
+    auto msg = GetRoot<Message>(buf);
+    // hops and source can only be patched if they are already present
+    auto table = reinterpret_cast<const uint8_t*>(msg);
+    auto hops_field = tableField(table, Message::VT_HOPS);
+    auto source_field = tableField(table, Message::VT_SOURCE);
+    if (!hops_field || !source_field) {
+        return false;
+    }
+    // serialized source goes at the back of the buffer
+    fbb.Clear();
+    uoffset_t source_end = _peer_tracker.copyNodeInfo(fbb).o;
+    // copy of the received message in front, aligned to the start of the final buffer
+    fbb.PreAlign(len, sizeof(largest_scalar_t));
+    fbb.PushBytes(buf, len);
+    fbb.Finish(Offset<Message>(fbb.GetSize() - static_cast<uoffset_t>(table - buf)));
+    // patch hops and point source at the appended node info
+    auto out = fbb.GetBufferPointer();
+    auto out_table = out + ReadScalar<uoffset_t>(out);
+    WriteScalar<uint32_t>(out_table + (hops_field - table), msg->hops() + 1);
+    auto out_source_field = out_table + (source_field - table);
+    auto out_source = out + fbb.GetSize() - source_end;
+    WriteScalar<uoffset_t>(out_source_field, static_cast<uoffset_t>(out_source - out_source_field));
+    return true;
 }
 
 void MeshNode::sendPeerUpdates() {
@@ -152,7 +448,7 @@ void MeshNode::sendPeerUpdates() {
     _fbb.Finish(CreateMessage(_fbb,
             _time_sync.getTime(),                                // timestamp
             1,                                                   // hops
-            NodeInfo::Pack(_fbb, &_peer_tracker.getNodeInfo()),  // source
+            _peer_tracker.copyNodeInfo(_fbb),                    // source
             _fbb.CreateVector(_peer_offsets)                     // peers
             ));
     // create iterators for updating connections
@@ -170,24 +466,73 @@ void MeshNode::sendPeerUpdates() {
     std::set_difference(_recipients_buffer.begin(), _recipients_buffer.end(),
             _connected_peers.begin(), _connected_peers.end(), std::back_inserter(connector));
     // send message
-    _transport->transmit(_fbb.GetBufferPointer(), _fbb.GetSize());
-    _connected_peers.swap(_recipients_buffer);
     IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(PEER_UPDATES_SENT)}, _fbb.GetBufferPointer(),
             _fbb.GetSize());
+    transmitBuffer(_fbb, nullptr);
+    // connected peers are read under the entities lock when forwarding from other threads
+    const std::lock_guard<std::mutex> lock(_entities_mutex);
+    _connected_peers.swap(_recipients_buffer);
+    _peer_tracker.setNearestPeers(_connected_peers);
+    // copied since peers are updated without the entities lock held
+    _connected_coordinates.resize(_connected_peers.size());
+    for (size_t i = 0; i < _connected_peers.size(); ++i) {
+        auto peer = _peer_tracker.getPeers().find(_connected_peers[i]);
+        if (peer == _peer_tracker.getPeers().end()) {
+            _connected_coordinates[i].clear();
+        } else {
+            _connected_coordinates[i] = peer->second.node_info.coordinates;
+        }
+    }
+}
+
+void MeshNode::expireEntities() {
+    const std::lock_guard<std::mutex> lock(_entities_mutex);
+    _ego_sphere.expireEntities(_time_sync.getTime(), _peer_tracker.getNodeInfo());
+    _ego_sphere.publishSnapshot();
 }
 
 void MeshNode::receiveMessageHandler(const void* buffer, size_t len) {
+    // received buffer is only valid during the callback, so the pipeline keeps a copy
+    if (!_pipeline_workers.empty()) {
+        if (!pushPipeline(PipelineItem::MESSAGE, buffer, len, false)) {
+            IF_PTR(_logger, log, Logger::WARN, Error{STRERR(PIPELINE_QUEUE_FULL)}, buffer, len);
+        }
+        return;
+    }
+    if (!verifyMessage(buffer, len)) {
+        IF_PTR(_logger, log, Logger::WARN, Error{STRERR(MESSAGE_VERIFY_FAIL)}, buffer, len);
+        return;
+    }
+    if (_receive_batch_size > 1) {
+        auto buf = static_cast<const uint8_t*>(buffer);
+        nextBurstBuffer().assign(buf, buf + len);
+        if (_burst_size >= _receive_batch_size) {
+            applyBurst();
+        }
+    } else {
+        applyMessage(buffer, len);
+    }
+}
+
+bool MeshNode::verifyMessage(const void* buffer, size_t& len) {
     auto buf = static_cast<const uint8_t*>(buffer);
-    auto msg = GetRoot<Message>(buf);
     Verifier verifier(buf, len);
 #ifdef FLATBUFFERS_TRACK_VERIFIER_BUFFER_SIZE
     len = verifier.GetComputedSize();
 #endif
-    if (!msg->Verify(verifier)) {
-        Error error{STRERR(MESSAGE_VERIFY_FAIL)};
-        IF_PTR(_logger, log, Logger::WARN, error, buffer, len);
-        return;
+    return GetRoot<Message>(buf)->Verify(verifier);
+}
+
+void MeshNode::applyMessage(const void* buffer, size_t len) {
+    auto msg = GetRoot<Message>(buffer);
+    if (applyPeerUpdates(msg, buffer, len) && msg->entities()) {
+        Error error{STRERR(ENTITY_UPDATES_RECEIVED)};
+        IF_PTR(_logger, log, Logger::TRACE, error, buffer, len);
+        forwardEntityUpdates(_fbb, _receive_context, msg, buffer, len, true);
     }
+}
+
+bool MeshNode::applyPeerUpdates(const Message* msg, const void* buffer, size_t len) {
     switch (_peer_tracker.updatePeer(msg->source(), true)) {
         case PeerTracker::SUCCESS:
             if (msg->hops() == 1 && msg->timestamp() > 0) {
@@ -206,14 +551,431 @@ void MeshNode::receiveMessageHandler(const void* buffer, size_t len) {
             }
             // fall through
         case PeerTracker::SOURCE_SEQUENCE_STALE:
-            if (msg->entities()) {
-                Error error{STRERR(ENTITY_UPDATES_RECEIVED)};
-                IF_PTR(_logger, log, Logger::TRACE, error, buffer, len);
-                forwardEntityUpdates(_fbb, msg);
-            }
-            // fall through
+            return true;
         default:
-            break;
+            return false;
+    }
+}
+
+std::vector<uint8_t>& MeshNode::nextBurstBuffer() {
+    if (_burst_size == _burst_buffers.size()) {
+        _burst_buffers.emplace_back();
+    }
+    return _burst_buffers[_burst_size++];
+}
+
+void MeshNode::applyBurst() {
+    // peer updates of every message are applied first, then all entity updates at once
+    _burst_msgs.clear();
+    const std::vector<uint8_t>* last_buffer = nullptr;
+    for (size_t i = 0; i < _burst_size; ++i) {
+        const auto& buffer = _burst_buffers[i];
+        auto msg = GetRoot<Message>(buffer.data());
+        if (applyPeerUpdates(msg, buffer.data(), buffer.size()) && msg->entities()) {
+            Error error{STRERR(ENTITY_UPDATES_RECEIVED)};
+            IF_PTR(_logger, log, Logger::TRACE, error, buffer.data(), buffer.size());
+            _burst_msgs.push_back(msg);
+            last_buffer = &buffer;
+        }
+    }
+    _burst_size = 0;
+    // a lone message keeps the pass through path
+    if (_burst_msgs.size() == 1) {
+        forwardEntityUpdates(_fbb, _receive_context, _burst_msgs.front(), last_buffer->data(),
+                last_buffer->size(), true);
+    } else if (!_burst_msgs.empty()) {
+        forwardEntityUpdatesBatch();
+    }
+}
+
+void MeshNode::forwardEntityUpdatesBatch() {
+    auto& forward_entities = _receive_context.entities;
+    auto& forward_counts = _burst_forward_counts;
+    auto& entries = _receive_context.entries;
+    entries.clear();
+    bool per_peer = false;
+    {
+        // lock once and update ego sphere entities of the whole burst
+        const std::lock_guard<std::mutex> lock(_entities_mutex);
+        _ego_sphere.receiveEntityUpdatesBatch(forward_entities, forward_counts,
+                _burst_msgs.data(), _burst_msgs.size(), _peer_tracker, _time_sync.getTime());
+        _ego_sphere.publishSnapshot();
+        // don't forward updates if spectator
+        if (_spectator) {
+            return;
+        }
+        for (size_t i = 0, entity_index = 0; i < _burst_msgs.size(); ++i) {
+            auto msg = _burst_msgs[i];
+            const char* src_addr = msg->source() && msg->source()->address()
+                                           ? msg->source()->address()->c_str()
+                                           : nullptr;
+            for (size_t j = 0; j < forward_counts[i]; ++j, ++entity_index) {
+                auto entity = forward_entities[entity_index];
+                entries.push_back({entity, entityTimestamp(msg, entity), entityHops(msg, entity),
+                        src_addr});
+            }
+        }
+        per_peer = !_forward_coalesce && selectForwardEntries(_receive_context, entries);
+    }
+    if (_forward_coalesce) {
+        coalesceForwardEntries(entries);
+    } else {
+        transmitForwardEntries(_fbb, _receive_context, entries, per_peer);
+    }
+}
+
+bool MeshNode::selectForwardEntries(
+        ForwardContext& context, const std::vector<ForwardEntry>& entries) {
+    if (entries.empty()) {
+        return false;
+    }
+    return (_lod_distance > 0 && applyLevelOfDetail(context, entries)) ||
+           (_merge_forwards && excludeSources(context, entries));
+}
+
+void MeshNode::transmitForwardEntries(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+        const std::vector<ForwardEntry>& entries, bool per_peer) {
+    if (per_peer) {
+        transmitPerPeer(fbb, context, entries);
+    } else if (!entries.empty()) {
+        transmitEntries(fbb, context, entries, nullptr, nullptr);
+    }
+}
+
+static bool sameAddress(const char* a, const char* b) {
+    return a == b || (a && b && !std::strcmp(a, b));
+}
+
+void MeshNode::transmitEntries(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+        const std::vector<ForwardEntry>& entries, const uint8_t* keep,
+        const std::vector<std::string>* recipients) {
+    // merged entities keep their own timestamp and hops, relative to those of the first entity
+    // and the fewest hops, otherwise each message only holds entities that share both
+    int64_t base_timestamp = 0;
+    uint32_t base_hops = std::numeric_limits<uint32_t>::max();
+    if (_merge_forwards) {
+        bool first = true;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (keep && !keep[i]) {
+                continue;
+            }
+            if (first) {
+                base_timestamp = entries[i].timestamp;
+                first = false;
+            }
+            base_hops = std::min(base_hops, entries[i].hops);
+        }
+    }
+    // without recipients a message goes to every peer except the source of its entities
+    const char* src_addr = nullptr;
+    auto& entity_offsets = context.offsets;
+    entity_offsets.clear();
+    fbb.Clear();
+    const auto send_entities = [&]() {
+        auto entities = fbb.CreateVector(entity_offsets);
+        auto source = _peer_tracker.copyNodeInfo(fbb);
+        // always store hops so the next relay can patch it in place
+        fbb.ForceDefaults(true);
+        fbb.Finish(CreateMessage(fbb,
+                base_timestamp,  // timestamp
+                base_hops + 1,   // hops
+                source,          // source
+                {},              // peers
+                entities         // entities
+                ));
+        fbb.ForceDefaults(false);
+        IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(ENTITY_UPDATES_FORWARDED)},
+                fbb.GetBufferPointer(), fbb.GetSize());
+        if (recipients) {
+            transmitBuffer(fbb, *recipients);
+        } else {
+            transmitBuffer(fbb, src_addr);
+        }
+        fbb.Clear();
+        entity_offsets.clear();
+    };
+    // split up messages when entity updates size is exceeded or an entity can't share one
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (keep && !keep[i]) {
+            continue;
+        }
+        const auto& entry = entries[i];
+        const bool same_source = recipients || sameAddress(src_addr, entry.src_addr);
+        const bool same_base = _merge_forwards ||
+                               (entry.timestamp == base_timestamp && entry.hops == base_hops);
+        if (!entity_offsets.empty() && !(same_source && same_base)) {
+            send_entities();
+        }
+        if (entity_offsets.empty()) {
+            src_addr = entry.src_addr;
+            if (!_merge_forwards) {
+                base_timestamp = entry.timestamp;
+                base_hops = entry.hops;
+            }
+        }
+        entity_offsets.emplace_back(copyEntity(fbb, entry.entity,
+                entry.timestamp - base_timestamp, entry.hops - base_hops));
+        if (fbb.GetSize() >= _entity_updates_size) {
+            send_entities();
+        }
+    }
+    if (!entity_offsets.empty()) {
+        send_entities();
+    }
+}
+
+bool MeshNode::excludeSources(ForwardContext& context, const std::vector<ForwardEntry>& entries) {
+    bool mixed_sources = false;
+    for (const auto& entry : entries) {
+        mixed_sources |= !sameAddress(entries.front().src_addr, entry.src_addr);
+    }
+    if (!mixed_sources) {
+        return false;
+    }
+    // each source gets the merged entities of the others
+    const size_t n_entries = entries.size();
+    auto& peers = context.peers;
+    peers.assign(_connected_peers.begin(), _connected_peers.end());
+    auto& keep = context.keep;
+    keep.resize(peers.size() * n_entries);
+    for (size_t i = 0; i < peers.size(); ++i) {
+        for (size_t j = 0; j < n_entries; ++j) {
+            keep[i * n_entries + j] = !sameAddress(peers[i].c_str(), entries[j].src_addr);
+        }
+    }
+    return true;
+}
+
+bool MeshNode::applyLevelOfDetail(
+        ForwardContext& context, const std::vector<ForwardEntry>& entries) {
+    const size_t n_entries = entries.size();
+    const int64_t current_time = _time_sync.getTime();
+    auto& due = context.due;
+    due.resize(n_entries);
+    for (size_t i = 0; i < n_entries; ++i) {
+        due[i] = _ego_sphere.lodUpdateDue(entries[i].entity, current_time, _lod_interval);
+    }
+    // peers keep entities that are due, near them or missing coordinates, except their own
+    const float lod_distance_sqr = _lod_distance * _lod_distance;
+    auto& peers = context.peers;
+    peers.assign(_connected_peers.begin(), _connected_peers.end());
+    auto& keep = context.keep;
+    keep.resize(peers.size() * n_entries);
+    auto& far = context.far;
+    far.assign(n_entries, 0);
+    bool decimated = false;
+    for (size_t i = 0; i < peers.size(); ++i) {
+        const auto& peer_coordinates = _connected_coordinates[i];
+        auto row = &keep[i * n_entries];
+        for (size_t j = 0; j < n_entries; ++j) {
+            const auto& entry = entries[j];
+            const auto coordinates = entry.entity->coordinates();
+            const bool near = peer_coordinates.empty() || !coordinates ||
+                              distanceSqr(*coordinates, peer_coordinates) <= lod_distance_sqr;
+            far[j] |= !near;
+            decimated |= !near && !due[j];
+            row[j] = (near || due[j]) && !sameAddress(peers[i].c_str(), entry.src_addr);
+        }
+    }
+    // the interval only restarts once an update actually reached a distant peer
+    for (size_t j = 0; j < n_entries; ++j) {
+        if (due[j] && far[j]) {
+            _ego_sphere.markLodUpdate(entries[j].entity, current_time);
+        }
+    }
+    return decimated;
+}
+
+void MeshNode::transmitPerPeer(fb::FlatBufferBuilder& fbb, ForwardContext& context,
+        const std::vector<ForwardEntry>& entries) {
+    // peers that keep the same entries share messages
+    const size_t n_entries = entries.size();
+    const auto& keep = context.keep;
+    auto& grouped = context.grouped;
+    grouped.assign(context.peers.size(), 0);
+    for (size_t i = 0; i < grouped.size(); ++i) {
+        if (grouped[i]) {
+            continue;
+        }
+        auto row = &keep[i * n_entries];
+        auto& recipients = context.recipients;
+        recipients.clear();
+        for (size_t j = i; j < grouped.size(); ++j) {
+            if (!grouped[j] && std::equal(row, row + n_entries, &keep[j * n_entries])) {
+                grouped[j] = 1;
+                recipients.push_back(context.peers[j]);
+            }
+        }
+        transmitEntries(fbb, context, entries, row, &recipients);
+    }
+}
+
+void MeshNode::coalesceForwardEntries(const std::vector<ForwardEntry>& entries) {
+    for (const auto& entry : entries) {
+        auto name = entry.entity->name();
+        const auto name_id = _pending_forward_names.intern(name->c_str(), name->size());
+        if (name_id >= _pending_forward_slots.size()) {
+            _pending_forward_slots.resize(_pending_forward_names.idBound());
+        }
+        // a pending update of the same entity is replaced unless it is newer
+        auto& slot = _pending_forward_slots[name_id];
+        if (slot < _n_pending_forwards && _pending_forwards[slot].name_id == name_id) {
+            if (_pending_forwards[slot].timestamp > entry.timestamp) {
+                continue;
+            }
+            _pending_forward_bytes -= _pending_forwards[slot].entity.size();
+        } else {
+            slot = _n_pending_forwards++;
+            if (slot == _pending_forwards.size()) {
+                _pending_forwards.emplace_back();
+            }
+        }
+        // copy the entity since the received message is released after this
+        auto& pending = _pending_forwards[slot];
+        _pending_forward_fbb.Clear();
+        _pending_forward_fbb.Finish(copyEntity(_pending_forward_fbb, entry.entity, 0, 0));
+        pending.name_id = name_id;
+        pending.entity.assign(
+                _pending_forward_fbb.GetBufferPointer(), _pending_forward_fbb.GetSize());
+        pending.timestamp = entry.timestamp;
+        pending.hops = entry.hops;
+        pending.src_addr.assign(entry.src_addr ? entry.src_addr : "");
+        _pending_forward_bytes += pending.entity.size();
+    }
+    // no need to wait once a full message is pending
+    if (_pending_forward_bytes >= _entity_updates_size) {
+        flushForwards();
+    }
+}
+
+void MeshNode::flushForwards() {
+    auto& entries = _flush_entries;
+    entries.clear();
+    for (size_t i = 0; i < _n_pending_forwards; ++i) {
+        auto& pending = _pending_forwards[i];
+        entries.push_back({pending.entity.get(), pending.timestamp, pending.hops,
+                pending.src_addr.empty() ? nullptr : pending.src_addr.c_str()});
+        _pending_forward_names.release(pending.name_id);
+    }
+    _n_pending_forwards = 0;
+    _pending_forward_bytes = 0;
+    bool per_peer;
+    {
+        const std::lock_guard<std::mutex> lock(_entities_mutex);
+        per_peer = selectForwardEntries(_receive_context, entries);
+    }
+    transmitForwardEntries(_fbb, _receive_context, entries, per_peer);
+}
+
+bool MeshNode::pushPipeline(
+        PipelineItem::Kind kind, const void* buffer, size_t len, bool block) {
+    auto& worker = *_pipeline_workers[_pipeline_pushed.load() % _pipeline_workers.size()];
+    PipelineItem* item;
+    for (size_t idle_count = 0; !(item = worker.input.back()); backoff(idle_count)) {
+        if (!block || !_pipeline_running) {
+            return false;
+        }
+    }
+    auto buf = static_cast<const uint8_t*>(buffer);
+    item->kind = kind;
+    item->buffer.assign(buf, buf + len);
+    worker.input.push();
+    _pipeline_pushed.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+void MeshNode::runPipelineWorker(PipelineWorker& worker, const std::string& self_address) {
+    size_t idle_count = 0;
+    while (_pipeline_running) {
+        auto in = worker.input.front();
+        auto out = in ? worker.output.back() : nullptr;
+        if (!out) {
+            backoff(idle_count);
+            continue;
+        }
+        idle_count = 0;
+        // swap so the input slot gets back storage of an already applied item
+        std::swap(*in, *out);
+        worker.input.pop();
+        if (out->kind == PipelineItem::MESSAGE) {
+            size_t len = out->buffer.size();
+            if (!verifyMessage(out->buffer.data(), len)) {
+                out->kind = PipelineItem::INVALID;
+            } else {
+                out->buffer.resize(len);
+                // messages from this node would be rejected by the peer tracker anyway
+                auto source = GetRoot<Message>(out->buffer.data())->source();
+                if (source && source->address() && self_address == source->address()->c_str()) {
+                    out->kind = PipelineItem::REJECTED;
+                }
+            }
+        }
+        worker.output.push();
+    }
+}
+
+void MeshNode::runPipelineApply() {
+    size_t idle_count = 0;
+    for (size_t sequence = 0; _pipeline_running;) {
+        auto& worker = *_pipeline_workers[sequence % _pipeline_workers.size()];
+        auto item = worker.output.front();
+        // messages ready back to back are applied as a burst
+        const bool burst_end = !item || item->kind != PipelineItem::MESSAGE ||
+                               _burst_size >= _receive_batch_size;
+        if (_burst_size && burst_end) {
+            applyBurst();
+            _pipeline_applied.store(sequence, std::memory_order_release);
+        }
+        if (!item) {
+            backoff(idle_count);
+            continue;
+        }
+        idle_count = 0;
+        if (item->kind == PipelineItem::MESSAGE && _receive_batch_size > 1) {
+            // swap so the slot gets back storage of an already applied burst
+            std::swap(nextBurstBuffer(), item->buffer);
+            worker.output.pop();
+            ++sequence;
+            continue;
+        }
+        switch (item->kind) {
+            case PipelineItem::MESSAGE:
+                applyMessage(item->buffer.data(), item->buffer.size());
+                break;
+            case PipelineItem::PEER_UPDATE:
+                sendPeerUpdates();
+                break;
+            case PipelineItem::ENTITY_EXPIRY:
+                expireEntities();
+                break;
+            case PipelineItem::INVALID: {
+                // logged here since workers can't share the logger
+                Error error{STRERR(MESSAGE_VERIFY_FAIL)};
+                IF_PTR(_logger, log, Logger::WARN, error, item->buffer.data(),
+                        item->buffer.size());
+                break;
+            }
+            case PipelineItem::FORWARD_FLUSH:
+                flushForwards();
+                break;
+            case PipelineItem::ENTITY_FLUSH:
+                flushEntityUpdates();
+                break;
+            case PipelineItem::ENTITY_SUBMIT:
+                sendSubmittedEntities();
+                break;
+            default:
+                break;
+        }
+        worker.output.pop();
+        _pipeline_applied.store(++sequence, std::memory_order_release);
+    }
+}
+
+void MeshNode::flushPipeline() const {
+    const size_t pushed = _pipeline_pushed.load(std::memory_order_acquire);
+    while (_pipeline_running && _pipeline_applied.load(std::memory_order_acquire) < pushed) {
+        std::this_thread::yield();
     }
 }
 
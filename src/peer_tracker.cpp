@@ -1,6 +1,7 @@
 #include <vsm/peer_tracker.hpp>
 #include <vsm/quick_hull.hpp>
 #include <algorithm>
+#include <cstring>
 
 namespace vsm {
 
@@ -16,10 +17,62 @@ PeerTracker::PeerTracker(Config config, std::shared_ptr<Logger> logger)
     _node_info.address = std::move(_config.address);
     _node_info.coordinates = std::move(_config.coordinates);
     _node_info.group_mask = std::move(_config.group_mask);
+    packNodeInfo();
 
     IF_PTR(_logger, log, Logger::INFO, Error{STRERR(PeerTracker::INITIALIZED)}, &_node_info);
 }
 
+void PeerTracker::packNodeInfo() {
+    const std::lock_guard<std::mutex> lock(_node_info_mutex);
+    _node_info_fbb.Clear();
+    _node_info_fbb.Finish(NodeInfo::Pack(_node_info_fbb, &_node_info));
+}
+
+fb::Offset<NodeInfo> PeerTracker::copyNodeInfo(fb::FlatBufferBuilder& fbb) const {
+    const std::lock_guard<std::mutex> lock(_node_info_mutex);
+    const auto buf = _node_info_fbb.GetBufferPointer();
+    const auto len = _node_info_fbb.GetSize();
+    // serialized offsets are relative, so the finished buffer can be pushed as is
+    fbb.PreAlign(len, sizeof(fb::largest_scalar_t));
+    fbb.PushBytes(buf, len);
+    return fbb.GetSize() - fb::ReadScalar<fb::uoffset_t>(buf);
+}
+
+void PeerTracker::setNearestPeers(const std::vector<std::string>& peers) {
+    _nearest_dims = _node_info.coordinates.size();
+    _nearest_nodes.clear();
+    for (const auto& address : peers) {
+        auto peer = findPeer(address.data(), address.size());
+        if (peer) {
+            _nearest_nodes.push_back(peer->node_info);
+        }
+    }
+    _nearest_packed.clear();
+    for (const auto& node : _nearest_nodes) {
+        if (node.coordinates.size() == _nearest_dims) {
+            _nearest_packed.push_back(&node);
+        }
+    }
+    const size_t n_blocks = (_nearest_packed.size() + NEAREST_BLOCK - 1) / NEAREST_BLOCK;
+    _nearest_coordinates.assign(n_blocks * NEAREST_BLOCK * _nearest_dims, 0);
+    for (size_t j = 0; j < _nearest_packed.size(); ++j) {
+        float* block = &_nearest_coordinates[j / NEAREST_BLOCK * NEAREST_BLOCK * _nearest_dims];
+        for (size_t i = 0; i < _nearest_dims; ++i) {
+            block[i * NEAREST_BLOCK + j % NEAREST_BLOCK] = _nearest_packed[j]->coordinates[i];
+        }
+    }
+}
+
+Peer& PeerTracker::insertPeer(const char* address, size_t len) {
+    auto& peer = *_peers.emplace(std::string(address, len), Peer{}).first;
+    const auto id = _addresses.intern(peer.first);
+    if (id >= _peers_by_id.size()) {
+        _peers_by_id.resize(_addresses.idBound(), nullptr);
+    }
+    _peers_by_id[id] = &peer;
+    return peer.second;
+}
+
 PeerTracker::ErrorType PeerTracker::latchPeer(const char* address, uint32_t latch_duration) {
     if (!address) {
         Error error{STRERR(PEER_ADDRESS_MISSING)};
@@ -31,7 +84,9 @@ PeerTracker::ErrorType PeerTracker::latchPeer(const char* address, uint32_t latc
         IF_PTR(_logger, log, Logger::ERROR, error, address);
         return PEER_IS_SELF;
     }
-    auto& peer = _peers[address];
+    const size_t address_len = std::strlen(address);
+    auto existing_peer = findPeer(address, address_len);
+    auto& peer = existing_peer ? *existing_peer : insertPeer(address, address_len);
     if (peer.node_info.address.empty()) {
         peer.node_info.address = address;
     }
@@ -52,8 +107,9 @@ PeerTracker::ErrorType PeerTracker::updatePeer(const NodeInfo* node_info, bool i
         return PEER_ADDRESS_MISSING;
     }
     // reject updates corresponds to this node
-    auto peer_address = node_info->address()->c_str();
-    if (_node_info.address == peer_address) {
+    auto peer_address = node_info->address();
+    if (!_node_info.address.compare(
+                0, std::string::npos, peer_address->c_str(), peer_address->size())) {
         return PEER_IS_SELF;
     }
     // reject missing coordinates
@@ -62,9 +118,10 @@ PeerTracker::ErrorType PeerTracker::updatePeer(const NodeInfo* node_info, bool i
         return PEER_COORDINATES_MISSING;
     }
     // check if peer exists in lookup
-    auto emplace_result = _peers.emplace(peer_address, Peer{});
-    auto& peer = emplace_result.first->second;
-    if (emplace_result.second) {
+    auto existing_peer = findPeer(peer_address->c_str(), peer_address->size());
+    auto& peer = existing_peer ? *existing_peer
+                               : insertPeer(peer_address->c_str(), peer_address->size());
+    if (!existing_peer) {
         IF_PTR(_logger, log, Logger::INFO, Error{STRERR(NEW_PEER_DISCOVERED)}, node_info);
     } else if (is_source) {
         // reset rank factor if any message is directly recieved from source
@@ -78,7 +135,7 @@ PeerTracker::ErrorType PeerTracker::updatePeer(const NodeInfo* node_info, bool i
         IF_PTR(_logger, log, Logger::DEBUG, Error{STRERR(PEER_SEQUENCE_STALE)}, node_info);
         return PEER_SEQUENCE_STALE;
     }
-    node_info->UnPackTo(&(peer.node_info));
+    unpackNodeInfo(node_info, peer.node_info);
     peer.track_until = add32(_node_info.sequence, _config.tracking_duration);
     IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(PEER_UPDATED)}, &peer.node_info,
             sizeof(NodeInfoT));
@@ -94,7 +151,10 @@ int PeerTracker::receivePeerUpdates(const Message* msg) {
         auto update_error = updatePeer(node_info);
         if (update_error == PEER_IS_SELF) {
             // catch up to previous known sequence number
-            _node_info.sequence = std::max(_node_info.sequence, node_info->sequence());
+            if (node_info->sequence() > _node_info.sequence) {
+                _node_info.sequence = node_info->sequence();
+                packNodeInfo();
+            }
             // respond to peers that contacted this node
             if (msg->source() && msg->source()->address()) {
                 _recipients.emplace_back(msg->source()->address()->c_str());
@@ -105,44 +165,115 @@ int PeerTracker::receivePeerUpdates(const Message* msg) {
     return peers_updated;
 }
 
+void PeerTracker::selectHull(size_t n_dims) {
+    // pack candidate coordinates contiguously
+    _hull_coordinates.clear();
+    for (auto hull_candidate : _hull_candidates) {
+        if (hull_candidate) {
+            _hull_coordinates.insert(_hull_coordinates.end(),
+                    hull_candidate->inverted_coordinates.begin(),
+                    hull_candidate->inverted_coordinates.end());
+            hull_candidate->on_hull = false;
+        } else {
+            _hull_coordinates.insert(_hull_coordinates.end(), n_dims, 0);
+        }
+    }
+    _hull_peers.clear();
+    const auto hull_indices =
+            QuickHull::convexHull(_hull_coordinates.data(), _hull_candidates.size(), n_dims);
+    _hull_vertices = hull_indices.size();
+    for (auto index : hull_indices) {
+        if (_hull_candidates[index]) {
+            _hull_candidates[index]->on_hull = true;
+        }
+        _hull_peers.push_back(_hull_candidates[index]);
+    }
+    // co-located candidates collapse into one hull vertex, select every peer at that point
+    for (size_t i = 0; i < _hull_candidates.size(); ++i) {
+        auto hull_candidate = _hull_candidates[i];
+        if (!hull_candidate || hull_candidate->on_hull) {
+            continue;
+        }
+        const float* point = _hull_coordinates.data() + i * n_dims;
+        for (auto index : hull_indices) {
+            if (std::equal(point, point + n_dims, _hull_coordinates.data() + index * n_dims)) {
+                hull_candidate->on_hull = true;
+                _hull_peers.push_back(hull_candidate);
+                break;
+            }
+        }
+    }
+}
+
 void PeerTracker::updatePeerSelections(
         std::vector<std::string>& selected_peers, std::vector<std::string>& recipients) {
     selected_peers.clear();
     recipients.clear();
-    // build candidate points list
-    std::vector<const Peer*> candidate_peers;
-    std::vector<std::vector<float>> candidate_points;
-    candidate_peers.reserve(_peers.size());
-    candidate_points.reserve(_peers.size());
+    _candidate_peers.clear();
+    _added_peers.clear();
+    // previous hull can only be extended if origin is unchanged and hull was not degenerate
+    const size_t n_dims = _node_info.coordinates.size();
+    bool rebuild = _selection_origin != _node_info.coordinates || _hull_vertices <= n_dims;
+    // removing a hull point requires a rebuild, removing an interior point changes nothing
+    const auto remove_candidate = [&rebuild](Peer& peer) {
+        rebuild |= peer.on_hull;
+        peer.on_hull = false;
+        peer.inverted_coordinates.clear();
+    };
+    // build candidate peers list
+    QuickHull::Point inverted_coordinates;
     for (auto peer = _peers.begin(); peer != _peers.end();) {
         // add latched peer to selected list
         if (peer->second.latch_until >= _node_info.sequence) {
             selected_peers.emplace_back(peer->second.node_info.address);
             _recipients.emplace_back(peer->second.node_info.address);
+            remove_candidate(peer->second);
             ++peer;
             continue;
         }
         // delete peer if tracking expired
         if (peer->second.track_until < _node_info.sequence) {
+            remove_candidate(peer->second);
+            const auto id = _addresses.find(peer->first);
+            _peers_by_id[id] = nullptr;
+            _addresses.release(id);
             peer = _peers.erase(peer);
             continue;
         }
         // add peer as candidate only of they belong in the same group
         if (_node_info.group_mask & peer->second.node_info.group_mask) {
-            candidate_points.emplace_back(peer->second.node_info.coordinates);
-            candidate_peers.emplace_back(&peer->second);
+            inverted_coordinates = peer->second.node_info.coordinates;
+            QuickHull::sphereInversion(inverted_coordinates, _node_info.coordinates);
+            // new or moved candidates are treated as an interior point removal plus an insertion
+            if (inverted_coordinates != peer->second.inverted_coordinates) {
+                remove_candidate(peer->second);
+                peer->second.inverted_coordinates.swap(inverted_coordinates);
+                _added_peers.emplace_back(&peer->second);
+            }
+            _candidate_peers.emplace_back(&peer->second);
+        } else {
+            remove_candidate(peer->second);
         }
         ++peer;
     }
+    // recompute hull only when candidates changed
+    if (rebuild || _candidate_peers.size() <= n_dims + 1) {
+        _hull_candidates = _candidate_peers;
+        // constrain hull to contain origin point
+        _hull_candidates.push_back(nullptr);
+        selectHull(n_dims);
+    } else if (!_added_peers.empty()) {
+        // interior points stay interior when points are added, so only extend the previous hull
+        _hull_candidates = _hull_peers;
+        _hull_candidates.insert(_hull_candidates.end(), _added_peers.begin(), _added_peers.end());
+        selectHull(n_dims);
+    }
+    _selection_origin = _node_info.coordinates;
     // add interior hull neighbors to selected peers
-    QuickHull::sphereInversion(candidate_points, _node_info.coordinates);
-    // constrain hull to contain origin point
-    candidate_points.emplace_back(_node_info.coordinates.size(), 0);
-    auto neighbor_points = QuickHull::convexHull(candidate_points);
-    for (size_t i = 0; i < candidate_peers.size(); ++i) {
-        if (neighbor_points.count(candidate_points[i])) {
-            selected_peers.emplace_back(candidate_peers[i]->node_info.address);
-            _recipients.emplace_back(candidate_peers[i]->node_info.address);
+    for (const auto candidate_peer : _candidate_peers) {
+        if (candidate_peer->on_hull) {
+            selected_peers.emplace_back(candidate_peer->node_info.address);
+            _recipients.emplace_back(candidate_peer->node_info.address);
         }
     }
     // remove duplicates from recipients list
@@ -152,6 +283,7 @@ void PeerTracker::updatePeerSelections(
     _recipients.swap(recipients);
     // tick node sequence
     ++_node_info.sequence;
+    packNodeInfo();
     IF_PTR(_logger, log, Logger::TRACE, Error{STRERR(PEER_SELECTIONS_GENERATED)});
 }
 
@@ -1,52 +1,368 @@
 #include <vsm/quick_hull.hpp>
 #include <quickhull.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
 namespace vsm {
 
-QuickHull::PointSet QuickHull::convexHull(
-        const std::vector<Point>& points, bool include_coplanar, Value epsilon) {
-    PointSet hull_points;
+// presents a row of the flat point buffer as a read-only container of the leading n_dims values
+struct PointRef {
+    using value_type = QuickHull::Value;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+    const value_type* data;
+    size_t n_dims;
+
+    const_iterator begin() const { return data; }
+    const_iterator end() const { return data + n_dims; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    size_t size() const { return n_dims; }
+    const value_type& operator[](size_t i) const { return data[i]; }
+};
+
+using Vec2 = std::array<double, 2>;
+using Vec3 = std::array<double, 3>;
+
+static Vec3 operator-(const Vec3& a, const Vec3& b) {
+    return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+}
+
+static double dot(const Vec3& a, const Vec3& b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+// Andrew's monotone chain, returns false if all points are collinear
+static bool convexHull2D(const std::vector<PointRef>& points, const std::vector<size_t>& indices,
+        std::vector<char>& hull_mask, bool include_coplanar, double epsilon) {
+    const size_t n_points = points.size();
+    std::vector<Vec2> coords(n_points);
+    std::vector<size_t> order(n_points);
+    for (size_t i = 0; i < n_points; ++i) {
+        coords[i] = {points[i][0], points[i][1]};
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return coords[a] < coords[b]; });
+    // strict left turn, points within epsilon of the line o-a are treated as collinear
+    const auto left_turn = [&](size_t o, size_t a, size_t b) {
+        const double ax = coords[a][0] - coords[o][0], ay = coords[a][1] - coords[o][1];
+        const double bx = coords[b][0] - coords[o][0], by = coords[b][1] - coords[o][1];
+        return ax * by - ay * bx > epsilon * std::sqrt(ax * ax + ay * ay);
+    };
+    std::vector<size_t> chain(2 * n_points);
+    size_t k = 0;
+    // lower chain
+    for (size_t i = 0; i < n_points; ++i) {
+        while (k >= 2 && !left_turn(chain[k - 2], chain[k - 1], order[i])) {
+            --k;
+        }
+        chain[k++] = order[i];
+    }
+    // upper chain
+    for (size_t i = n_points - 1, lower_size = k + 1; i-- > 0;) {
+        while (k >= lower_size && !left_turn(chain[k - 2], chain[k - 1], order[i])) {
+            --k;
+        }
+        chain[k++] = order[i];
+    }
+    // last point repeats the first
+    chain.resize(k - 1);
+    if (chain.size() < 3) {
+        return false;
+    }
+    std::vector<char> vertex_mask(n_points, 0);
+    for (auto vertex : chain) {
+        vertex_mask[vertex] = 1;
+        hull_mask[indices[vertex]] = 1;
+    }
+    if (include_coplanar) {
+        for (size_t i = 0; i < n_points; ++i) {
+            // interior points are more than epsilon behind every edge
+            for (size_t j = 0; !vertex_mask[i] && j < chain.size(); ++j) {
+                const auto& a = coords[chain[j]];
+                const auto& b = coords[chain[(j + 1) % chain.size()]];
+                const double ex = b[0] - a[0], ey = b[1] - a[1];
+                const double px = coords[i][0] - a[0], py = coords[i][1] - a[1];
+                if (px * ey - py * ex >= -epsilon * std::sqrt(ex * ex + ey * ey)) {
+                    vertex_mask[i] = 1;
+                    hull_mask[indices[i]] = 1;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// quickhull on fixed size points, returns false if all points are coplanar
+static bool convexHull3D(const std::vector<PointRef>& points, const std::vector<size_t>& indices,
+        std::vector<char>& hull_mask, bool include_coplanar, double epsilon) {
+    struct Face {
+        std::array<size_t, 3> vertices;  // counter-clockwise when viewed from outside
+        Vec3 normal;
+        double offset;
+        std::vector<size_t> outside;
+        size_t farthest;
+        double farthest_distance;
+        bool deleted;
+    };
+    const size_t n_points = points.size();
+    std::vector<Vec3> coords(n_points);
+    for (size_t i = 0; i < n_points; ++i) {
+        coords[i] = {points[i][0], points[i][1], points[i][2]};
+    }
+    // find initial simplex from extreme points
+    std::array<size_t, 6> extremes{};
+    for (size_t i = 1; i < n_points; ++i) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+            if (coords[i][axis] < coords[extremes[2 * axis]][axis]) {
+                extremes[2 * axis] = i;
+            }
+            if (coords[i][axis] > coords[extremes[2 * axis + 1]][axis]) {
+                extremes[2 * axis + 1] = i;
+            }
+        }
+    }
+    size_t v0 = 0, v1 = 0;
+    double max_distance = 0;
+    for (auto a : extremes) {
+        for (auto b : extremes) {
+            const auto ab = coords[b] - coords[a];
+            if (dot(ab, ab) > max_distance) {
+                max_distance = dot(ab, ab);
+                v0 = a;
+                v1 = b;
+            }
+        }
+    }
+    if (std::sqrt(max_distance) <= epsilon) {
+        return false;
+    }
+    size_t v2 = 0;
+    max_distance = 0;
+    const auto line = coords[v1] - coords[v0];
+    for (size_t i = 0; i < n_points; ++i) {
+        const auto normal = cross(line, coords[i] - coords[v0]);
+        if (dot(normal, normal) > max_distance) {
+            max_distance = dot(normal, normal);
+            v2 = i;
+        }
+    }
+    if (std::sqrt(max_distance / dot(line, line)) <= epsilon) {
+        return false;
+    }
+    size_t v3 = 0;
+    max_distance = 0;
+    const auto plane = cross(line, coords[v2] - coords[v0]);
+    const double plane_norm = std::sqrt(dot(plane, plane));
+    for (size_t i = 0; i < n_points; ++i) {
+        const double distance = std::abs(dot(plane, coords[i] - coords[v0])) / plane_norm;
+        if (distance > max_distance) {
+            max_distance = distance;
+            v3 = i;
+        }
+    }
+    if (max_distance <= epsilon) {
+        return false;
+    }
+
+    std::vector<Face> faces;
+    // maps directed edge to the face that contains it
+    std::unordered_map<uint64_t, size_t> edges;
+    const auto edge_key = [](size_t a, size_t b) { return (uint64_t(a) << 32) | uint64_t(b); };
+    const auto distance = [&](const Face& face, size_t point) {
+        return dot(face.normal, coords[point]) - face.offset;
+    };
+    const auto add_face = [&](size_t a, size_t b, size_t c) {
+        Face face{{{a, b, c}}, cross(coords[b] - coords[a], coords[c] - coords[a]), 0, {}, 0, 0,
+                false};
+        const double norm = std::sqrt(dot(face.normal, face.normal));
+        for (auto& coord : face.normal) {
+            coord = norm > 0 ? coord / norm : 0;
+        }
+        face.offset = dot(face.normal, coords[a]);
+        edges[edge_key(a, b)] = faces.size();
+        edges[edge_key(b, c)] = faces.size();
+        edges[edge_key(c, a)] = faces.size();
+        faces.push_back(std::move(face));
+    };
+    const auto assign_outside = [&](size_t point, size_t first_face) {
+        Face* best = nullptr;
+        double best_distance = epsilon;
+        for (size_t f = first_face; f < faces.size(); ++f) {
+            const double point_distance = distance(faces[f], point);
+            if (!faces[f].deleted && point_distance > best_distance) {
+                best_distance = point_distance;
+                best = &faces[f];
+            }
+        }
+        if (best) {
+            if (best->outside.empty() || best_distance > best->farthest_distance) {
+                best->farthest = point;
+                best->farthest_distance = best_distance;
+            }
+            best->outside.push_back(point);
+        }
+    };
+    // orient tetrahedron so that v3 is behind face v0-v1-v2
+    if (dot(plane, coords[v3] - coords[v0]) > 0) {
+        std::swap(v1, v2);
+    }
+    add_face(v0, v1, v2);
+    add_face(v0, v3, v1);
+    add_face(v1, v3, v2);
+    add_face(v2, v3, v0);
+    for (size_t i = 0; i < n_points; ++i) {
+        if (i != v0 && i != v1 && i != v2 && i != v3) {
+            assign_outside(i, 0);
+        }
+    }
+
+    std::vector<size_t> visited;
+    std::vector<char> visible;
+    std::vector<size_t> stack;
+    std::vector<std::pair<size_t, size_t>> horizon;
+    std::vector<size_t> orphans;
+    for (size_t iteration = 0, f = 0; f < faces.size(); ++f) {
+        if (faces[f].deleted || faces[f].outside.empty()) {
+            continue;
+        }
+        const size_t eye = faces[f].farthest;
+        ++iteration;
+        visited.resize(faces.size(), 0);
+        visible.resize(faces.size(), 0);
+        horizon.clear();
+        orphans.clear();
+        // flood fill faces visible from eye point and collect horizon edges
+        visited[f] = iteration;
+        visible[f] = 1;
+        stack.assign(1, f);
+        while (!stack.empty()) {
+            auto& face = faces[stack.back()];
+            stack.pop_back();
+            for (size_t i = 0; i < 3; ++i) {
+                const size_t a = face.vertices[i], b = face.vertices[(i + 1) % 3];
+                const auto neighbor = edges.find(edge_key(b, a));
+                if (neighbor == edges.end()) {
+                    continue;
+                }
+                const size_t n = neighbor->second;
+                if (visited[n] != iteration) {
+                    visited[n] = iteration;
+                    visible[n] = distance(faces[n], eye) > epsilon;
+                    if (visible[n]) {
+                        stack.push_back(n);
+                    }
+                }
+                if (!visible[n]) {
+                    horizon.emplace_back(a, b);
+                }
+            }
+            face.deleted = true;
+            for (size_t i = 0; i < 3; ++i) {
+                edges.erase(edge_key(face.vertices[i], face.vertices[(i + 1) % 3]));
+            }
+            orphans.insert(orphans.end(), face.outside.cbegin(), face.outside.cend());
+            face.outside = {};
+        }
+        // connect horizon to eye point and reassign orphaned points
+        const size_t first_new_face = faces.size();
+        for (const auto& edge : horizon) {
+            add_face(edge.first, edge.second, eye);
+        }
+        for (auto orphan : orphans) {
+            if (orphan != eye) {
+                assign_outside(orphan, first_new_face);
+            }
+        }
+    }
+    // convert face vertices to indices
+    std::vector<char> vertex_mask(n_points, 0);
+    for (const auto& face : faces) {
+        for (size_t i = 0; !face.deleted && i < 3; ++i) {
+            vertex_mask[face.vertices[i]] = 1;
+            hull_mask[indices[face.vertices[i]]] = 1;
+        }
+    }
+    if (include_coplanar) {
+        for (size_t i = 0; i < n_points; ++i) {
+            // interior points are more than epsilon behind every face
+            for (size_t f = 0; !vertex_mask[i] && f < faces.size(); ++f) {
+                if (!faces[f].deleted && distance(faces[f], i) >= -epsilon) {
+                    vertex_mask[i] = 1;
+                    hull_mask[indices[i]] = 1;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<size_t> QuickHull::convexHull(const Value* points, size_t n_points, size_t n_dims,
+        bool include_coplanar, Value epsilon) {
+    std::vector<size_t> hull_indices;
     // reject empty input
-    if (points.empty() || points.front().empty()) {
-        return hull_points;
+    if (!points || !n_points || !n_dims) {
+        return hull_indices;
     }
+    std::vector<char> hull_mask(n_points, 0);
     // filter input
-    std::vector<Point> filtered_points;
-    filtered_points.reserve(points.size());
-    for (const auto& point : points) {
+    std::vector<PointRef> filtered_points;
+    std::vector<size_t> filtered_indices;
+    filtered_points.reserve(n_points);
+    filtered_indices.reserve(n_points);
+    for (size_t i = 0; i < n_points; ++i) {
+        const Value* point = points + i * n_dims;
         // filter out if any coordinate extends to infinity from input
-        if (std::any_of(point.cbegin(), point.cend(), [](Value coord) {
+        if (std::any_of(point, point + n_dims, [](Value coord) {
                 return std::abs(coord) >= std::numeric_limits<Value>::max();
             })) {
             // add infinite points directly to hull
-            hull_points.insert(point);
+            hull_mask[i] = 1;
         } else {
             // append point after filters
-            filtered_points.push_back(point);
+            filtered_points.push_back({point, n_dims});
+            filtered_indices.push_back(i);
         }
     }
-    for (auto n_dims = filtered_points.front().size(); n_dims > 1; --n_dims) {
-        // force uniform dimensions
+    for (; !filtered_points.empty() && n_dims > 1; --n_dims) {
+        // only consider leading dimensions
         for (auto& filtered_point : filtered_points) {
-            filtered_point.resize(n_dims, 0);
+            filtered_point.n_dims = n_dims;
         }
         // return if fewer points than required for initial basis
         if (filtered_points.size() <= n_dims) {
-            for (const auto& filtered_point : filtered_points) {
-                hull_points.insert(filtered_point);
+            for (auto index : filtered_indices) {
+                hull_mask[index] = 1;
             }
             break;
         }
         // skip empty dimensions
+        const Value front_coord = filtered_points.front()[n_dims - 1];
         if (std::all_of(filtered_points.cbegin(), filtered_points.cend(),
-                    [&](const Point& filtered_point) {
-                        return std::abs(filtered_point.back() - filtered_points.front().back()) <
-                               epsilon;
+                    [&](const PointRef& filtered_point) {
+                        return std::abs(filtered_point[n_dims - 1] - front_coord) < epsilon;
                     })) {
             continue;
         }
+        // specialized kernels for the common low dimensional cases
+        if (n_dims == 2 || n_dims == 3) {
+            if ((n_dims == 2 ? convexHull2D : convexHull3D)(
+                        filtered_points, filtered_indices, hull_mask, include_coplanar, epsilon)) {
+                break;
+            }
+            continue;
+        }
         // instantiate quick hull
-        quick_hull<std::vector<Point>::const_iterator> quick_hull(n_dims, epsilon);
+        quick_hull<std::vector<PointRef>::const_iterator> quick_hull(n_dims, epsilon);
         // add points and find initial simplex
         quick_hull.add_points(filtered_points.cbegin(), filtered_points.cend());
         const auto initial_simplex = quick_hull.get_affine_basis();
@@ -56,44 +372,73 @@ QuickHull::PointSet QuickHull::convexHull(
             quick_hull.create_initial_simplex(
                     initial_simplex.cbegin(), std::prev(initial_simplex.cend()));
             quick_hull.create_convex_hull();
-            // convert facet to hull points
+            // convert facet vertices to indices
+            const auto mark_vertex = [&](std::vector<PointRef>::const_iterator vertex) {
+                hull_mask[filtered_indices[vertex - filtered_points.cbegin()]] = 1;
+            };
             for (const auto& facet : quick_hull.facets_) {
-                for (const auto& vertex : facet.vertices_) {
-                    hull_points.insert(*vertex);
-                }
+                std::for_each(facet.vertices_.cbegin(), facet.vertices_.cend(), mark_vertex);
                 if (include_coplanar) {
-                    for (const auto& vertex : facet.coplanar_) {
-                        hull_points.insert(*vertex);
-                    }
+                    std::for_each(facet.coplanar_.cbegin(), facet.coplanar_.cend(), mark_vertex);
                 }
             }
             break;
         }
     }
+    for (size_t i = 0; i < n_points; ++i) {
+        if (hull_mask[i]) {
+            hull_indices.push_back(i);
+        }
+    }
+    return hull_indices;
+}
+
+QuickHull::PointSet QuickHull::convexHull(
+        const std::vector<Point>& points, bool include_coplanar, Value epsilon) {
+    PointSet hull_points;
+    // reject empty input
+    if (points.empty() || points.front().empty()) {
+        return hull_points;
+    }
+    // pack points with uniform dimensions
+    const size_t n_dims = points.front().size();
+    std::vector<Value> flat_points(points.size() * n_dims, 0);
+    for (size_t i = 0; i < points.size(); ++i) {
+        std::copy_n(points[i].cbegin(), std::min(n_dims, points[i].size()),
+                flat_points.begin() + i * n_dims);
+    }
+    for (auto index :
+            convexHull(flat_points.data(), points.size(), n_dims, include_coplanar, epsilon)) {
+        hull_points.insert(points[index]);
+    }
     return hull_points;
 }
 
 void QuickHull::sphereInversion(std::vector<Point>& points, const Point& origin) {
     for (auto& point : points) {
-        // center points around origin
-        point.resize(origin.size(), 0);
-        for (size_t i = 0; i < origin.size(); ++i) {
-            point[i] -= origin[i];
-        }
-        // calculate distance from origin
-        Value r2 = 0;
-        for (auto coord : point) {
-            r2 += coord * coord;
-        }
-        // divide by zero check
-        if (r2 == 0) {
-            point = Point(point.size(), std::numeric_limits<Value>::max());
-            continue;
-        }
-        // invert distance from origin
-        for (auto& coord : point) {
-            coord /= r2;
-        }
+        sphereInversion(point, origin);
+    }
+}
+
+void QuickHull::sphereInversion(Point& point, const Point& origin) {
+    // center point around origin
+    point.resize(origin.size(), 0);
+    for (size_t i = 0; i < origin.size(); ++i) {
+        point[i] -= origin[i];
+    }
+    // calculate distance from origin
+    Value r2 = 0;
+    for (auto coord : point) {
+        r2 += coord * coord;
+    }
+    // divide by zero check
+    if (r2 == 0) {
+        point.assign(point.size(), std::numeric_limits<Value>::max());
+        return;
+    }
+    // invert distance from origin
+    for (auto& coord : point) {
+        coord /= r2;
     }
 }
 
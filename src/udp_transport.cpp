@@ -0,0 +1,196 @@
+#include <vsm/udp_transport.hpp>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace vsm {
+
+UdpTransport::UdpTransport(std::string address, size_t batch_size, size_t max_message_size)
+        : _address(std::move(address))
+        , _socket(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0))
+        , _max_message_size(max_message_size)
+        // receive slots start on aligned boundaries so payloads after the header do too
+        , _rx_buffer(std::max<size_t>(batch_size, 1) * alignUp(max_message_size))
+        , _rx_iovecs(std::max<size_t>(batch_size, 1))
+        , _rx_msgs(std::max<size_t>(batch_size, 1)) {
+    if (_socket < 0) {
+        throw std::system_error(errno, std::generic_category(), "UdpTransport socket");
+    }
+    sockaddr_in sock_addr;
+    if (!parseAddress(_address.c_str(), sock_addr)) {
+        ::close(_socket);
+        throw std::system_error(EINVAL, std::generic_category(), "UdpTransport " + _address);
+    }
+    if (::bind(_socket, reinterpret_cast<sockaddr*>(&sock_addr), sizeof(sock_addr))) {
+        int err_code = errno;
+        ::close(_socket);
+        throw std::system_error(err_code, std::generic_category(), "UdpTransport " + _address);
+    }
+    // point each receive slot at its own region of the shared buffer
+    for (size_t i = 0; i < _rx_msgs.size(); ++i) {
+        _rx_iovecs[i].iov_base = _rx_buffer.data() + i * alignUp(max_message_size);
+        _rx_iovecs[i].iov_len = max_message_size;
+        std::memset(&_rx_msgs[i], 0, sizeof(mmsghdr));
+        _rx_msgs[i].msg_hdr.msg_iov = &_rx_iovecs[i];
+        _rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+UdpTransport::~UdpTransport() {
+    ::close(_socket);
+}
+
+bool UdpTransport::parseAddress(const char* address, sockaddr_in& sock_addr) {
+    static constexpr char scheme[] = "udp://";
+    if (std::strncmp(address, scheme, sizeof(scheme) - 1)) {
+        return false;
+    }
+    std::string host(address + sizeof(scheme) - 1);
+    auto colon = host.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::string port = host.substr(colon + 1);
+    host.resize(colon);
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_NUMERICSERV | (host == "*" ? AI_PASSIVE : 0);
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host == "*" ? nullptr : host.c_str(), port.c_str(), &hints, &result)) {
+        return false;
+    }
+    std::memcpy(&sock_addr, result->ai_addr, sizeof(sock_addr));
+    freeaddrinfo(result);
+    return true;
+}
+
+int UdpTransport::connect(const char* dst_addr) {
+    sockaddr_in sock_addr;
+    if (!parseAddress(dst_addr, sock_addr)) {
+        errno = EINVAL;
+        return -1;
+    }
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    _destinations.emplace(dst_addr, sock_addr);
+    return 0;
+}
+
+int UdpTransport::disconnect(const char* dst_addr) {
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    return _destinations.erase(dst_addr) ? 0 : -1;
+}
+
+int UdpTransport::transmitTo(const void* buffer, size_t len,
+        const std::vector<std::string>& dst_addrs, const char* group) {
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    _tx_msgs.clear();
+    for (const auto& dst_addr : dst_addrs) {
+        auto destination = _destinations.find(dst_addr);
+        if (destination != _destinations.end()) {
+            _tx_msgs.emplace_back();
+            _tx_msgs.back().msg_hdr.msg_name = &destination->second;
+        }
+    }
+    return sendToRecipients(buffer, len, group);
+}
+
+int UdpTransport::transmitExcept(
+        const void* buffer, size_t len, const char* exclude_addr, const char* group) {
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    _tx_msgs.clear();
+    for (auto& destination : _destinations) {
+        if (!exclude_addr || std::strcmp(destination.first.c_str(), exclude_addr)) {
+            _tx_msgs.emplace_back();
+            _tx_msgs.back().msg_hdr.msg_name = &destination.second;
+        }
+    }
+    return sendToRecipients(buffer, len, group);
+}
+
+int UdpTransport::sendToRecipients(const void* buffer, size_t len, const char* group) {
+    // group header and payload are gathered by the kernel, all messages share the same iovecs
+    const size_t group_len = std::strlen(group);
+    const size_t header_len = alignUp(1 + group_len);
+    if (group_len > UINT8_MAX || header_len + len > _max_message_size) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    uint8_t header[1 + UINT8_MAX] = {};
+    header[0] = static_cast<uint8_t>(group_len);
+    std::memcpy(header + 1, group, group_len);
+    iovec iov[2] = {{header, header_len}, {const_cast<void*>(buffer), len}};
+    for (auto& tx_msg : _tx_msgs) {
+        tx_msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        tx_msg.msg_hdr.msg_iov = iov;
+        tx_msg.msg_hdr.msg_iovlen = 2;
+    }
+    // sendmmsg may stop early, a failed destination is skipped so the rest still get sent
+    int result = static_cast<int>(len);
+    for (size_t sent = 0; sent < _tx_msgs.size();) {
+        int n_sent = ::sendmmsg(_socket, &_tx_msgs[sent], _tx_msgs.size() - sent, 0);
+        if (n_sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = -1;
+            n_sent = 1;
+        }
+        sent += n_sent;
+    }
+    return result;
+}
+
+int UdpTransport::poll(size_t timeout_ms) {
+    _timers.execute();
+    int next_timeout = std::min<uint32_t>(timeout_ms, _timers.timeout());
+    pollfd poll_fd{_socket, POLLIN, 0};
+    int err_code = ::poll(&poll_fd, 1, next_timeout);
+    if (err_code <= 0) {
+        return err_code ? errno : EAGAIN;
+    }
+    int n_msgs = 0;
+    for (;;) {
+        int n_received =
+                ::recvmmsg(_socket, _rx_msgs.data(), _rx_msgs.size(), MSG_DONTWAIT, nullptr);
+        if (n_received <= 0) {
+            err_code = n_received ? errno : EAGAIN;
+            break;
+        }
+        n_msgs += n_received;
+        for (int i = 0; i < n_received; ++i) {
+            auto data = static_cast<const uint8_t*>(_rx_iovecs[i].iov_base);
+            size_t len = _rx_msgs[i].msg_len;
+            // drop truncated or malformed datagrams
+            if ((_rx_msgs[i].msg_hdr.msg_flags & MSG_TRUNC) || !len ||
+                    alignUp(1u + data[0]) > len) {
+                continue;
+            }
+            _rx_group.assign(reinterpret_cast<const char*>(data + 1), data[0]);
+            auto receiver_callback = _receiver_callbacks.find(_rx_group);
+            if (receiver_callback != _receiver_callbacks.end()) {
+                const size_t header_len = alignUp(1u + data[0]);
+                receiver_callback->second(data + header_len, len - header_len);
+            }
+        }
+        if (static_cast<size_t>(n_received) < _rx_msgs.size()) {
+            break;
+        }
+    }
+    if (n_msgs) {
+        for (auto& burst_callback : _burst_callbacks) {
+            burst_callback();
+        }
+    }
+    return n_msgs ? 0 : err_code;
+}
+
+}  // namespace vsm
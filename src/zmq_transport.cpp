@@ -1,14 +1,101 @@
 #include <vsm/zmq_transport.hpp>
 
+#include <cstring>
+
 namespace vsm {
 
 ZmqTransport::ZmqTransport(std::string address)
         : _address(std::move(address))
-        , _tx_socket(_zmq_ctx, zmq::socket_type::radio)
         , _rx_socket(_zmq_ctx, zmq::socket_type::dish) {
     _rx_socket.bind(_address);
 }
 
+int ZmqTransport::connect(const char* dst_addr) {
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    if (_tx_sockets.count(dst_addr)) {
+        return 0;
+    }
+    zmq::socket_t tx_socket(_zmq_ctx, zmq::socket_type::radio);
+    if (int err_code = zmq_connect(tx_socket.handle(), dst_addr)) {
+        return err_code;
+    }
+    _tx_sockets.emplace(dst_addr, std::move(tx_socket));
+    return 0;
+}
+
+int ZmqTransport::disconnect(const char* dst_addr) {
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    return _tx_sockets.erase(dst_addr) ? 0 : -1;
+}
+
+int ZmqTransport::transmitTo(const void* buffer, size_t len,
+        const std::vector<std::string>& dst_addrs, const char* group) {
+    zmq::message_t msg(buffer, len);
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    selectRecipients(dst_addrs);
+    return sendToRecipients(msg, group);
+}
+
+int ZmqTransport::transmitExcept(
+        const void* buffer, size_t len, const char* exclude_addr, const char* group) {
+    zmq::message_t msg(buffer, len);
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    selectRecipients(exclude_addr);
+    return sendToRecipients(msg, group);
+}
+
+int ZmqTransport::transmitTo(void* buffer, size_t len, ReleaseCallback release, void* hint,
+        const std::vector<std::string>& dst_addrs, const char* group) {
+    zmq::message_t msg(buffer, len, release, hint);
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    selectRecipients(dst_addrs);
+    return sendToRecipients(msg, group);
+}
+
+int ZmqTransport::transmitExcept(void* buffer, size_t len, ReleaseCallback release, void* hint,
+        const char* exclude_addr, const char* group) {
+    zmq::message_t msg(buffer, len, release, hint);
+    const std::lock_guard<std::mutex> lock(_tx_mutex);
+    selectRecipients(exclude_addr);
+    return sendToRecipients(msg, group);
+}
+
+void ZmqTransport::selectRecipients(const std::vector<std::string>& dst_addrs) {
+    _tx_recipients.clear();
+    for (const auto& dst_addr : dst_addrs) {
+        auto tx_socket = _tx_sockets.find(dst_addr);
+        if (tx_socket != _tx_sockets.end()) {
+            _tx_recipients.push_back(&tx_socket->second);
+        }
+    }
+}
+
+void ZmqTransport::selectRecipients(const char* exclude_addr) {
+    _tx_recipients.clear();
+    for (auto& tx_socket : _tx_sockets) {
+        if (!exclude_addr || std::strcmp(tx_socket.first.c_str(), exclude_addr)) {
+            _tx_recipients.push_back(&tx_socket.second);
+        }
+    }
+}
+
+int ZmqTransport::sendToRecipients(zmq::message_t& msg, const char* group) {
+    msg.set_group(group);
+    int result = static_cast<int>(msg.size());
+    for (size_t i = 0; i < _tx_recipients.size(); ++i) {
+        // copies share the payload, the original is sent last
+        zmq::message_t copy;
+        if (i + 1 < _tx_recipients.size() && zmq_msg_copy(copy.handle(), msg.handle())) {
+            return -1;
+        }
+        auto& tx_msg = i + 1 < _tx_recipients.size() ? copy : msg;
+        if (zmq_sendmsg(_tx_recipients[i]->handle(), tx_msg.handle(), 0) < 0) {
+            result = -1;
+        }
+    }
+    return result;
+}
+
 int ZmqTransport::poll(size_t timeout_ms) {
     _timers.execute();
     int next_timeout = std::min<uint32_t>(timeout_ms, _timers.timeout());
@@ -21,6 +108,11 @@ int ZmqTransport::poll(size_t timeout_ms) {
             receiver_callback->second(_rx_message.data(), _rx_message.size());
         }
     }
+    if (n_msgs) {
+        for (auto& burst_callback : _burst_callbacks) {
+            burst_callback();
+        }
+    }
     return n_msgs ? 0 : zmq_errno();
 }
 
@@ -0,0 +1,42 @@
+#include <catch2/catch.hpp>
+#include <vsm/buffer_pool.hpp>
+
+using namespace vsm;
+
+TEST_CASE("Buffer Pool", "[buffer_pool]") {
+    BufferPool pool(2);
+
+    // blocks of the same size class are recycled
+    auto a = pool.allocate(100);
+    pool.deallocate(a, 100);
+    REQUIRE(pool.idleCount() == 1);
+    REQUIRE(pool.allocate(120) == a);
+    REQUIRE(pool.getStats().allocations == 1);
+    REQUIRE(pool.getStats().reuses == 1);
+
+    // other size classes allocate new blocks
+    auto b = pool.allocate(1000);
+    REQUIRE(b != a);
+    REQUIRE(pool.getStats().allocations == 2);
+
+    // idle blocks beyond the limit are freed
+    auto c = pool.allocate(1000);
+    pool.deallocate(a, 120);
+    pool.deallocate(b, 1000);
+    pool.deallocate(c, 1000);
+    REQUIRE(pool.idleCount() == 2);
+
+    // builders draw from the pool and detached buffers give their storage back
+    fb::FlatBufferBuilder fbb(1000, &pool);
+    fbb.Finish(fbb.CreateString("hello"));
+    auto reuses = pool.getStats().reuses;
+    REQUIRE(reuses > 1);
+    {
+        auto buffer = fbb.Release();
+        REQUIRE(pool.idleCount() == 1);
+    }
+    REQUIRE(pool.idleCount() == 2);
+    fbb.Finish(fbb.CreateString("world"));
+    REQUIRE(pool.getStats().reuses == reuses + 1);
+    REQUIRE(pool.getStats().allocations == 3);
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch.hpp>
+#include <vsm/dedup_cache.hpp>
+
+#include <random>
+#include <string>
+
+using namespace vsm;
+
+TEST_CASE("Dedup Cache", "[dedup_cache]") {
+    constexpr size_t capacity = 100;
+    DedupCache cache(capacity);
+    auto fingerprint = [](int i) {
+        auto name = std::to_string(i % 7);
+        return DedupCache::fingerprint(name.data(), name.size(), i);
+    };
+
+    // fill to capacity without evictions
+    for (int i = 0; i < (int) capacity; ++i) {
+        REQUIRE(!cache.contains(fingerprint(i)));
+        REQUIRE(cache.insert(fingerprint(i)));
+        REQUIRE(!cache.insert(fingerprint(i)));
+    }
+    REQUIRE(cache.size() == capacity);
+    REQUIRE(cache.getStats().evictions == 0);
+    REQUIRE(cache.evictionRate() == 0);
+    REQUIRE(cache.estimatedFalsePositiveRate() > 0);
+    REQUIRE(cache.estimatedFalsePositiveRate() < 1e-15);
+
+    // same name with different timestamp or same timestamp with different name are distinct
+    REQUIRE(DedupCache::fingerprint("a", 1, 1) != DedupCache::fingerprint("a", 1, 2));
+    REQUIRE(DedupCache::fingerprint("a", 1, 1) != DedupCache::fingerprint("b", 1, 1));
+
+    // oldest entries are evicted first
+    for (int i = capacity; i < (int) (3 * capacity); ++i) {
+        REQUIRE(cache.insert(fingerprint(i)));
+        REQUIRE(cache.size() == capacity);
+        REQUIRE(!cache.contains(fingerprint(i - capacity)));
+        // remaining entries are still reachable after backward shift deletion
+        for (int j = i - capacity + 1; j <= i; ++j) {
+            REQUIRE(cache.contains(fingerprint(j)));
+        }
+    }
+    REQUIRE(cache.getStats().inserts == 3 * capacity);
+    REQUIRE(cache.getStats().evictions == 2 * capacity);
+    REQUIRE(cache.evictionRate() == Approx(2.0 / 3));
+
+    // random fingerprints with clustered low bits stress probe chains
+    std::mt19937 gen(0);
+    std::vector<uint64_t> history;
+    for (int i = 0; i < 10000; ++i) {
+        uint64_t fp = (static_cast<uint64_t>(gen()) << 32) | (gen() & 0x3F) | 1;
+        if (cache.insert(fp)) {
+            history.push_back(fp);
+        }
+        REQUIRE(cache.size() == capacity);
+    }
+    for (size_t i = 0; i < history.size(); ++i) {
+        REQUIRE(cache.contains(history[i]) == (i + capacity >= history.size()));
+    }
+
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(!cache.contains(history.back()));
+}
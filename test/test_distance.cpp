@@ -0,0 +1,92 @@
+#include <catch2/catch.hpp>
+#include <vsm/distance.hpp>
+
+#include <random>
+#include <vector>
+
+using namespace vsm;
+
+// unspecialized loop for reference
+static float referenceDistanceSqr(const std::vector<float>& a, const std::vector<float>& b) {
+    float d2 = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        float d = b[i] - a[i];
+        d2 += d * d;
+    }
+    return d2;
+}
+
+// packs points so that row i holds coordinate i of every point
+static std::vector<float> packRows(const std::vector<std::vector<float>>& points, size_t n_dims) {
+    std::vector<float> rows(points.size() * n_dims);
+    for (size_t j = 0; j < points.size(); ++j) {
+        for (size_t i = 0; i < n_dims; ++i) {
+            rows[i * points.size() + j] = points[j][i];
+        }
+    }
+    return rows;
+}
+
+static std::vector<std::vector<float>> randomPoints(size_t n_points, size_t n_dims) {
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-100, 100);
+    std::vector<std::vector<float>> points(n_points, std::vector<float>(n_dims));
+    for (auto& point : points) {
+        for (auto& coord : point) {
+            coord = dis(gen);
+        }
+    }
+    return points;
+}
+
+TEST_CASE("Distance Squared", "[distance]") {
+    size_t n_dims;
+    SECTION("1D") { n_dims = 1; }
+    SECTION("2D") { n_dims = 2; }
+    SECTION("3D") { n_dims = 3; }
+    SECTION("4D") { n_dims = 4; }
+    SECTION("7D") { n_dims = 7; }
+
+    // odd count exercises the vector remainder
+    const auto points = randomPoints(37, n_dims);
+    const auto rows = packRows(points, n_dims);
+    std::vector<float> distances(points.size());
+    for (const auto& point : points) {
+        distanceSqrBatch(distances.data(), point, rows.data(), points.size());
+        for (size_t j = 0; j < points.size(); ++j) {
+            REQUIRE(distanceSqr(point, points[j]) == referenceDistanceSqr(point, points[j]));
+            if (n_dims == 3) {
+                REQUIRE(distanceSqr<3>(point, points[j]) ==
+                        referenceDistanceSqr(point, points[j]));
+            }
+            REQUIRE(distances[j] == referenceDistanceSqr(point, points[j]));
+        }
+    }
+    REQUIRE(distanceSqr(points[0], std::vector<float>(n_dims + 1)) ==
+            std::numeric_limits<float>::max());
+}
+
+TEST_CASE("Distance Squared Benchmark", "[.][benchmark][distance]") {
+    const size_t n_points = 1024;
+    const auto points = randomPoints(n_points, 3);
+    const auto rows = packRows(points, 3);
+    const auto& query = points.front();
+    std::vector<float> distances(n_points);
+
+    BENCHMARK("reference") {
+        for (size_t j = 0; j < n_points; ++j) {
+            distances[j] = referenceDistanceSqr(query, points[j]);
+        }
+        return distances.back();
+    };
+    BENCHMARK("fixed dimension") {
+        for (size_t j = 0; j < n_points; ++j) {
+            distances[j] = distanceSqr<3>(query, points[j]);
+        }
+        return distances.back();
+    };
+    BENCHMARK("batch") {
+        distanceSqrBatch(distances.data(), query, rows.data(), n_points);
+        return distances.back();
+    };
+}
@@ -5,14 +5,30 @@
 
 #include <deque>
 #include <iostream>
+#include <random>
 
 using namespace vsm;
 
 static constexpr int64_t SECS = 1000000000;
 
+// packs entities into one message from a remote source and applies it to ego_sphere
+static void receiveEntities(EgoSphere& ego_sphere, const PeerTracker& peer_tracker,
+        const std::vector<EntityT>& entities, int64_t timestamp) {
+    fb::FlatBufferBuilder fbb;
+    std::vector<fb::Offset<Entity>> entity_offsets;
+    for (const auto& entity : entities) {
+        entity_offsets.emplace_back(Entity::Pack(fbb, &entity));
+    }
+    NodeInfoT source;
+    source.address = "source";
+    fbb.Finish(CreateMessage(fbb, timestamp, 1, NodeInfo::Pack(fbb, &source), {},
+            fbb.CreateVector(entity_offsets)));
+    ego_sphere.receiveEntityUpdates(fb::GetRoot<Message>(fbb.GetBufferPointer()), peer_tracker, 0);
+}
+
 TEST_CASE("Single World", "[ego_sphere]") {
 #if 0
-    auto entity_update_handler = [](EgoSphere::EntityUpdate* new_entity,
+    auto entity_update_handler = [](const EgoSphere::EntityUpdate* new_entity,
                                          const EgoSphere::EntityUpdate* old_entity,
                                          const NodeInfoT* source) {
         std::cout << "entity_update: source " << (source ? source->name : "null") << " old "
@@ -106,6 +122,12 @@ TEST_CASE("Single World", "[ego_sphere]") {
         REQUIRE(entity_lookup.first.size() == 2);
         REQUIRE(entity_lookup.first.count("b"));
         REQUIRE(entity_lookup.first.count("e"));
+        // stored entities are readable through their flatbuffer view
+        const auto& stored = entity_lookup.first.at("e").entity;
+        REQUIRE(stored->name()->str() == "e");
+        REQUIRE(stored->range() == 10);
+        REQUIRE(stored->expiry() == entities[4].expiry);
+        REQUIRE(distanceSqr(*stored->coordinates(), entities[4].coordinates) == 0);
 #if 0
         for (const auto& entity : entity_lookup.first) {
             std::cout << entity.first << std::endl;
@@ -372,3 +394,282 @@ TEST_CASE("4 corners", "[ego_sphere]") {
     }
 #endif
 }
+
+TEST_CASE("Entity Expiry Order", "[ego_sphere]") {
+    PeerTracker peer_tracker({
+            "node",     // name
+            "address",  // address
+            {0, 0},     // coordinates
+    });
+    EgoSphere ego_sphere({});
+    // setup random generator
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int64_t> dis(1, 1000);
+
+    // create message with entities of random expiry
+    std::vector<EntityT> entities(1000);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = std::to_string(i);
+        entities[i].expiry = dis(gen);
+    }
+    receiveEntities(ego_sphere, peer_tracker, entities, 1);
+    REQUIRE(ego_sphere.getEntities().size() == entities.size());
+
+    // change expiry of half the entities
+    for (size_t i = 0; i < entities.size(); i += 2) {
+        entities[i].expiry = dis(gen);
+    }
+    receiveEntities(ego_sphere, peer_tracker, entities, 2);
+    // delete some entities
+    for (size_t i = 0; i < entities.size(); i += 7) {
+        REQUIRE(ego_sphere.deleteEntity(entities[i].name, peer_tracker.getNodeInfo()));
+        entities[i].expiry = 0;
+    }
+
+    // expect entities to expire exactly when their expiry is reached
+    for (int64_t time = 0; time <= 1000; time += 10) {
+        ego_sphere.expireEntities(time, peer_tracker.getNodeInfo());
+        for (const auto& entity : entities) {
+            bool alive = entity.expiry > time;
+            REQUIRE(ego_sphere.getEntities().count(entity.name) == alive);
+        }
+    }
+    REQUIRE(ego_sphere.getEntities().empty());
+}
+
+TEST_CASE("Entity Spatial Queries", "[ego_sphere]") {
+    PeerTracker peer_tracker({
+            "node",     // name
+            "address",  // address
+            {0, 0, 0},  // coordinates
+    });
+    EgoSphere::Config config;
+    config.spatial_cell_size = 2;
+    EgoSphere ego_sphere(config);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-20, 20);
+
+    // compare queries against a brute force scan of stored entities
+    auto check_queries = [&]() {
+        for (int i = 0; i < 20; ++i) {
+            std::vector<float> center{dis(gen), dis(gen), dis(gen)};
+            float radius = std::abs(dis(gen)) / 2;
+            std::vector<std::pair<float, std::string>> expected;
+            for (const auto& entity : ego_sphere.getEntities()) {
+                if (entity.second.entity->coordinates()) {
+                    expected.emplace_back(
+                            distanceSqr(*entity.second.entity->coordinates(), center),
+                            entity.first);
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+            // radius query
+            std::vector<std::string> within;
+            for (const auto& entity : ego_sphere.queryRadius(center, radius)) {
+                within.emplace_back(entity->first);
+            }
+            size_t n_within = 0;
+            for (const auto& entity : expected) {
+                n_within += entity.first <= radius * radius;
+            }
+            REQUIRE(within.size() == n_within);
+            std::sort(within.begin(), within.end());
+            for (size_t j = 0; j < n_within; ++j) {
+                REQUIRE(std::binary_search(within.begin(), within.end(), expected[j].second));
+            }
+            // nearest query
+            size_t k = i * 5;
+            auto nearest = ego_sphere.queryKNearest(center, k);
+            REQUIRE(nearest.size() == std::min(k, expected.size()));
+            for (size_t j = 0; j < nearest.size(); ++j) {
+                REQUIRE(distanceSqr(*nearest[j]->second.entity->coordinates(), center) ==
+                        expected[j].first);
+            }
+        }
+    };
+
+    // create entities, some without coordinates
+    std::vector<EntityT> entities(500);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = std::to_string(i);
+        entities[i].expiry = 10 + i;
+        if (i % 10) {
+            entities[i].coordinates = {dis(gen), dis(gen), dis(gen)};
+        }
+    }
+    receiveEntities(ego_sphere, peer_tracker, entities, 1);
+    REQUIRE(ego_sphere.getEntities().size() == entities.size());
+    check_queries();
+
+    // move some entities and give coordinates to others
+    for (size_t i = 0; i < entities.size(); i += 3) {
+        entities[i].coordinates = {dis(gen), dis(gen), dis(gen)};
+    }
+    receiveEntities(ego_sphere, peer_tracker, entities, 2);
+    check_queries();
+
+    // remove entities through deletion and expiry
+    for (size_t i = 0; i < entities.size(); i += 7) {
+        REQUIRE(ego_sphere.deleteEntity(entities[i].name, peer_tracker.getNodeInfo()));
+    }
+    ego_sphere.expireEntities(250, peer_tracker.getNodeInfo());
+    check_queries();
+    ego_sphere.expireEntities(1000, peer_tracker.getNodeInfo());
+    REQUIRE(ego_sphere.queryKNearest({0, 0, 0}, 10).empty());
+    REQUIRE(ego_sphere.queryRadius({0, 0, 0}, 100).empty());
+}
+
+TEST_CASE("Entity Snapshots", "[ego_sphere]") {
+    PeerTracker peer_tracker({
+            "node",     // name
+            "address",  // address
+            {0, 0},     // coordinates
+    });
+    EgoSphere::Config config;
+    config.entity_snapshots = true;
+    EgoSphere ego_sphere(config);
+    REQUIRE(ego_sphere.getSnapshot()->empty());
+
+    int64_t timestamp = 0;
+    auto update_entities = [&](const std::vector<EntityT>& entities) {
+        receiveEntities(ego_sphere, peer_tracker, entities, ++timestamp);
+        ego_sphere.publishSnapshot();
+    };
+    // snapshot must match entities exactly at the time it was published
+    auto matches_entities = [&](const EgoSphere::EntityLookup& snapshot) {
+        if (snapshot.size() != ego_sphere.getEntities().size()) {
+            return false;
+        }
+        for (const auto& entity : ego_sphere.getEntities()) {
+            auto found = snapshot.find(entity.first);
+            if (found == snapshot.end() ||
+                    found->second.entity->expiry() != entity.second.entity->expiry()) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<EntityT> entities(100);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = std::to_string(i);
+        entities[i].expiry = 100 + i;
+    }
+    update_entities(entities);
+    auto held = ego_sphere.getSnapshot();
+    REQUIRE(matches_entities(*held));
+
+    // alternate updates, deletes and expiry while a reader holds on to an old snapshot
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = round; i < entities.size(); i += 3) {
+            entities[i].expiry += 1000;
+        }
+        update_entities(entities);
+        REQUIRE(matches_entities(*ego_sphere.getSnapshot()));
+        ego_sphere.deleteEntity(entities[round * 7].name, peer_tracker.getNodeInfo());
+        ego_sphere.expireEntities(100 + round * 5, peer_tracker.getNodeInfo());
+        ego_sphere.publishSnapshot();
+        REQUIRE(matches_entities(*ego_sphere.getSnapshot()));
+        // release held snapshot on some rounds so both recycle and copy paths are taken
+        if (round % 3 == 0) {
+            held = ego_sphere.getSnapshot();
+        } else {
+            held.reset();
+        }
+    }
+    // held snapshot is unaffected by later changes
+    held = ego_sphere.getSnapshot();
+    auto held_size = held->size();
+    ego_sphere.expireEntities(100000, peer_tracker.getNodeInfo());
+    ego_sphere.publishSnapshot();
+    REQUIRE(held->size() == held_size);
+    REQUIRE(ego_sphere.getSnapshot()->empty());
+}
+
+TEST_CASE("Entity Updates Batch", "[ego_sphere]") {
+    PeerTracker peer_tracker({"self", "self", {0, 0}});
+    EgoSphere ego_sphere({});
+    const auto make_entity = [](const char* name, int64_t timestamp_offset, uint32_t hops_offset) {
+        std::unique_ptr<EntityT> entity(new EntityT());
+        entity->name = name;
+        entity->expiry = std::numeric_limits<int64_t>::max();
+        entity->hop_limit = 3;
+        entity->timestamp_offset = timestamp_offset;
+        entity->hops_offset = hops_offset;
+        return entity;
+    };
+    std::vector<fb::FlatBufferBuilder> fbbs(2);
+    std::vector<const Message*> msgs;
+    for (auto timestamp : {100, 200}) {
+        MessageT msg;
+        msg.timestamp = timestamp;
+        msg.source.reset(new NodeInfoT());
+        msg.source->address = "source";
+        if (timestamp == 100) {
+            msg.entities.emplace_back(make_entity("a", 0, 0));
+            // merged entity exceeds hop limit with its own hops
+            msg.entities.emplace_back(make_entity("b", 5, 2));
+        } else {
+            // same timestamp as the first "a" after the offset, so it's a duplicate
+            msg.entities.emplace_back(make_entity("a", -100, 0));
+            msg.entities.emplace_back(make_entity("c", 0, 0));
+        }
+        auto& fbb = fbbs[msgs.size()];
+        fbb.Finish(Message::Pack(fbb, &msg));
+        msgs.push_back(fb::GetRoot<Message>(fbb.GetBufferPointer()));
+    }
+
+    std::vector<const Entity*> forward_entities;
+    std::vector<size_t> forward_counts;
+    ego_sphere.receiveEntityUpdatesBatch(
+            forward_entities, forward_counts, msgs.data(), msgs.size(), peer_tracker, 0);
+    REQUIRE(forward_counts == std::vector<size_t>{1, 1});
+    REQUIRE(forward_entities.size() == 2);
+    REQUIRE(forward_entities[0]->name()->str() == "a");
+    REQUIRE(forward_entities[1]->name()->str() == "c");
+
+    // stored entities keep their own timestamp and hops without offsets
+    const auto& entities = ego_sphere.getEntities();
+    REQUIRE(entities.size() == 3);
+    REQUIRE(entities.at("a").source_timestamp == 100);
+    REQUIRE(entities.at("b").source_timestamp == 105);
+    REQUIRE(entities.at("b").hops == 3);
+    REQUIRE(entities.at("b").entity->timestamp_offset() == 0);
+    REQUIRE(entities.at("c").source_timestamp == 200);
+}
+
+TEST_CASE("Entity Level Of Detail", "[ego_sphere]") {
+    PeerTracker peer_tracker({"self", "self", {0, 0}});
+    EgoSphere ego_sphere({});
+    MessageT msg;
+    msg.source.reset(new NodeInfoT());
+    msg.source->address = "source";
+    msg.entities.emplace_back(new EntityT());
+    msg.entities.back()->name = "stored";
+    msg.entities.back()->expiry = std::numeric_limits<int64_t>::max();
+    msg.entities.emplace_back(new EntityT());
+    msg.entities.back()->name = "transient";
+    fb::FlatBufferBuilder fbb;
+    fbb.Finish(Message::Pack(fbb, &msg));
+    auto entities = fb::GetRoot<Message>(fbb.GetBufferPointer())->entities();
+    ego_sphere.receiveEntityUpdates(
+            fb::GetRoot<Message>(fbb.GetBufferPointer()), peer_tracker, 0);
+    REQUIRE(ego_sphere.getEntities().size() == 1);
+
+    // stored entities stay due until an update is marked as sent
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(0), 0, 100));
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(0), 50, 100));
+    ego_sphere.markLodUpdate(entities->Get(0), 50);
+    // then at most once per interval
+    REQUIRE_FALSE(ego_sphere.lodUpdateDue(entities->Get(0), 50, 100));
+    REQUIRE_FALSE(ego_sphere.lodUpdateDue(entities->Get(0), 149, 100));
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(0), 150, 100));
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(0), 200, 100));
+    ego_sphere.markLodUpdate(entities->Get(0), 200);
+    REQUIRE_FALSE(ego_sphere.lodUpdateDue(entities->Get(0), 250, 100));
+
+    // entities that aren't stored are always due
+    ego_sphere.markLodUpdate(entities->Get(1), 150);
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(1), 150, 100));
+    REQUIRE(ego_sphere.lodUpdateDue(entities->Get(1), 150, 100));
+}
@@ -0,0 +1,719 @@
+#include <catch2/catch.hpp>
+#include <vsm/inproc_transport.hpp>
+#include <vsm/mesh_node.hpp>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+
+using namespace vsm;
+
+TEST_CASE("InProc Transport Loopback", "[inproc][transport]") {
+    // test inputs
+    auto network = std::make_shared<InProcNetwork>();
+    auto endpoint = "node";
+    std::string test_msg = "Hello!";
+
+    // create loopback connection
+    InProcTransport inproc_transport(network, endpoint);
+    REQUIRE(inproc_transport.connect(endpoint) == 0);
+    REQUIRE_THROWS(InProcTransport(network, endpoint));
+
+    // register receiver handlers for default group and group "group"
+    std::vector<std::string> rx_msgs;
+    for (auto group : {"", "group"}) {
+        REQUIRE(inproc_transport.addReceiver(
+                        [&rx_msgs](const void* buffer, size_t len) {
+                            rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+                        },
+                        group) == 0);
+    }
+
+    // send message
+    for (auto group : {"", "", "group", "reject"}) {
+        REQUIRE(inproc_transport.transmit(test_msg.c_str(), test_msg.size(), group) ==
+                static_cast<int>(test_msg.size()));
+    }
+
+    // receive messages
+    REQUIRE(inproc_transport.poll(100) == 0);
+    REQUIRE(inproc_transport.poll(0) == EAGAIN);
+    REQUIRE(rx_msgs.size() == 3);
+    for (const auto& rx_msg : rx_msgs) {
+        REQUIRE(test_msg == rx_msg);
+    }
+    auto stats = inproc_transport.getStats();
+    REQUIRE(stats.tx_messages == 4);
+    REQUIRE(stats.rx_messages == 4);
+    REQUIRE(stats.rx_bytes == 4 * test_msg.size());
+}
+
+TEST_CASE("InProc Transport Recipients", "[inproc][transport]") {
+    auto network = std::make_shared<InProcNetwork>();
+    std::vector<std::string> endpoints{"a", "b", "c"};
+    std::string test_msg = "Hello!";
+
+    // create one transport per endpoint, each counting received messages
+    std::vector<std::unique_ptr<InProcTransport>> transports;
+    std::vector<int> rx_counts(endpoints.size(), 0);
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        transports.emplace_back(new InProcTransport(network, endpoints[i]));
+        REQUIRE(transports.back()->addReceiver(
+                        [&rx_counts, i](const void*, size_t) { ++rx_counts[i]; }) == 0);
+    }
+    auto& inproc_transport = *transports.front();
+    for (const auto& endpoint : endpoints) {
+        REQUIRE(inproc_transport.connect(endpoint.c_str()) == 0);
+    }
+
+    // transmit except source
+    inproc_transport.transmitExcept(test_msg.c_str(), test_msg.size(), "b");
+    network->run(10);
+    REQUIRE(rx_counts == std::vector<int>{1, 0, 1});
+
+    // transmit to subset, unknown addresses are skipped
+    inproc_transport.transmitTo(test_msg.c_str(), test_msg.size(), {"b", "d"});
+    network->run(10);
+    REQUIRE(rx_counts == std::vector<int>{1, 1, 1});
+
+    // owned buffer is shared by all recipients and released after the last delivery
+    int n_released = 0;
+    auto buffer = new char[test_msg.size()];
+    test_msg.copy(buffer, test_msg.size());
+    inproc_transport.transmit(
+            buffer, test_msg.size(),
+            [](void* data, void* hint) {
+                delete[] static_cast<char*>(data);
+                ++*static_cast<int*>(hint);
+            },
+            &n_released);
+    REQUIRE(n_released == 0);
+    network->run(10);
+    REQUIRE(n_released == 1);
+    REQUIRE(rx_counts == std::vector<int>{2, 2, 2});
+
+    // messages to a removed transport are dropped
+    REQUIRE(inproc_transport.disconnect("c") == 0);
+    REQUIRE(inproc_transport.disconnect("c") == -1);
+    inproc_transport.transmit(test_msg.c_str(), test_msg.size());
+    transports.back().reset();
+    network->run(10);
+    REQUIRE(rx_counts == std::vector<int>{3, 3, 2});
+    REQUIRE(network->pendingEvents() == 0);
+}
+
+TEST_CASE("InProc Network Conditions", "[inproc][transport]") {
+    InProcNetwork::Config config;
+    std::vector<int64_t> rx_times;
+    const auto make_pair = [&](std::shared_ptr<InProcNetwork> network) {
+        std::vector<std::unique_ptr<InProcTransport>> transports;
+        transports.emplace_back(new InProcTransport(network, "tx"));
+        transports.emplace_back(new InProcTransport(network, "rx"));
+        transports.front()->connect("rx");
+        transports.back()->addReceiver([&rx_times, network](const void*, size_t) {
+            rx_times.push_back(network->getTime());
+        });
+        return transports;
+    };
+    std::string test_msg(1000, 'x');
+
+    SECTION("Latency") {
+        config.latency_ms = 5;
+        auto network = std::make_shared<InProcNetwork>(config);
+        auto transports = make_pair(network);
+        transports.front()->transmit(test_msg.c_str(), test_msg.size());
+        REQUIRE(transports.back()->poll(4) == EAGAIN);
+        REQUIRE(network->getTime() == 4000000);
+        REQUIRE(transports.back()->poll(4) == 0);
+        REQUIRE(rx_times == std::vector<int64_t>{5000000});
+    }
+
+    SECTION("Loss") {
+        config.loss = 0.5;
+        auto network = std::make_shared<InProcNetwork>(config);
+        auto transports = make_pair(network);
+        for (int i = 0; i < 1000; ++i) {
+            transports.front()->transmit(test_msg.c_str(), test_msg.size());
+        }
+        network->run(10);
+        REQUIRE(rx_times.size() > 400);
+        REQUIRE(rx_times.size() < 600);
+        REQUIRE(transports.front()->getStats().dropped_messages == 1000 - rx_times.size());
+    }
+
+    SECTION("Bandwidth") {
+        // 1000 bytes take 1ms at 8000 kbps
+        config.latency_ms = 0;
+        config.bandwidth_kbps = 8000;
+        auto network = std::make_shared<InProcNetwork>(config);
+        auto transports = make_pair(network);
+        for (int i = 0; i < 3; ++i) {
+            transports.front()->transmit(test_msg.c_str(), test_msg.size());
+        }
+        network->run(10);
+        REQUIRE(rx_times == std::vector<int64_t>{1000000, 2000000, 3000000});
+    }
+
+    SECTION("Timers") {
+        auto network = std::make_shared<InProcNetwork>(config);
+        auto transports = make_pair(network);
+        std::vector<int64_t> timer_times;
+        REQUIRE(transports.front()->addTimer(10, [&](int timer_id) {
+            REQUIRE(timer_id == 1);
+            timer_times.push_back(network->getTime());
+        }) == 1);
+        network->run(35);
+        REQUIRE(timer_times == std::vector<int64_t>{10000000, 20000000, 30000000});
+        REQUIRE(transports.front()->getStats().cpu_ns > 0);
+    }
+}
+
+TEST_CASE("InProc MeshNode Grid", "[inproc][mesh_node]") {
+    // same layout as the udp graph test, at a scale that would exhaust local ports
+    auto network = std::make_shared<InProcNetwork>();
+    const int N = 12;
+    std::deque<MeshNode> mesh_nodes;
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            std::string address = "node" + std::to_string(N * i + j);
+            mesh_nodes.emplace_back(MeshNode::Config{
+                    100,    // peer update interval
+                    1000,   // entity expiry interval
+                    8000,   // entity updates size
+                    false,  // spectator
+                    {},     // ego sphere
+                    {
+                            address,                 // name
+                            address,                 // address
+                            {(float) j, (float) i},  // coordinates
+                    },
+                    std::make_shared<InProcTransport>(network, address),  // transport
+                    nullptr,                                              // logger
+                    [network]() { return network->getTime(); },          // local clock
+            });
+            mesh_nodes.back().getPeerTracker().latchPeer("node0", 1);
+        }
+    }
+    network->run(5000);
+
+    // interior nodes connect to their 4 direct neighbours
+    for (int i = 1; i < N - 1; ++i) {
+        for (int j = 1; j < N - 1; ++j) {
+            auto& mesh_node = mesh_nodes[N * i + j];
+            REQUIRE(mesh_node.getConnectedPeers().size() == 4);
+            for (auto& connected_peer : mesh_node.getConnectedPeers()) {
+                auto peer_info = mesh_node.getPeerTracker().getPeers().find(connected_peer);
+                REQUIRE(peer_info != mesh_node.getPeerTracker().getPeers().end());
+                REQUIRE(distanceSqr(peer_info->second.node_info.coordinates,
+                                mesh_node.getPeerTracker().getNodeInfo().coordinates) <= 1);
+            }
+        }
+    }
+
+    // staged entity update is flushed through the pipeline and floods the mesh
+    EntityT entity;
+    entity.name = "entity";
+    entity.expiry = std::numeric_limits<int64_t>::max();
+    mesh_nodes.front().updateEntities({entity});
+    network->run(1000);
+    for (auto& mesh_node : mesh_nodes) {
+        REQUIRE(mesh_node.getEntities().first.count("entity"));
+    }
+}
+
+TEST_CASE("InProc MeshNode Pipeline", "[inproc][mesh_node]") {
+    // same as the grid test with messages verified and applied in bursts on pipeline threads
+    auto network = std::make_shared<InProcNetwork>();
+    // verify failures are logged by apply threads of several nodes at once
+    auto logger = std::make_shared<Logger>();
+    std::atomic<int> verify_fails{0};
+    logger->addLogHandler(Logger::WARN,
+            [&verify_fails](int64_t, Logger::Level, Error error, const void*, size_t) {
+                verify_fails += error.type == MeshNode::MESSAGE_VERIFY_FAIL;
+            });
+    const int N = 3;
+    std::deque<MeshNode> mesh_nodes;
+    for (int i = 0; i < N; ++i) {
+        for (int j = 0; j < N; ++j) {
+            std::string address = "node" + std::to_string(N * i + j);
+            mesh_nodes.emplace_back(MeshNode::Config{
+                    100,    // peer update interval
+                    1000,   // entity expiry interval
+                    8000,   // entity updates size
+                    false,  // spectator
+                    {},     // ego sphere
+                    {
+                            address,                 // name
+                            address,                 // address
+                            {(float) j, (float) i},  // coordinates
+                    },
+                    std::make_shared<InProcTransport>(network, address),  // transport
+                    logger,                                               // logger
+                    [network]() { return network->getTime(); },          // local clock
+                    64,                                                   // buffer pool size
+                    2,                                                    // pipeline workers
+                    16,                                                   // pipeline queue size
+                    8,                                                    // receive batch size
+                    0,                                                    // forward coalesce ms
+                    10,                                                   // update coalesce ms
+            });
+            mesh_nodes.back().getPeerTracker().latchPeer("node0", 1);
+        }
+    }
+    // pipelines run in real time, so let them catch up after each step of virtual time
+    const auto run = [&](size_t duration_ms) {
+        for (size_t t = 0; t < duration_ms; t += 10) {
+            network->run(10);
+            for (auto& mesh_node : mesh_nodes) {
+                mesh_node.flushPipeline();
+            }
+        }
+    };
+    run(3000);
+    auto& center = mesh_nodes[N + 1];
+    REQUIRE(center.getConnectedPeers().size() == 4);
+
+    // invalid messages are rejected by the workers
+    InProcTransport sender(network, "sender");
+    sender.connect("node4");
+    std::string garbage = "not a message";
+    sender.transmit(garbage.c_str(), garbage.size());
+    run(10);
+    REQUIRE(verify_fails == 1);
+
+    // entity update floods the mesh
+    EntityT entity;
+    entity.name = "entity";
+    entity.expiry = std::numeric_limits<int64_t>::max();
+    mesh_nodes.front().updateEntities({entity});
+    run(1000);
+    for (auto& mesh_node : mesh_nodes) {
+        REQUIRE(mesh_node.getEntities().first.count("entity"));
+    }
+}
+
+TEST_CASE("InProc MeshNode Burst", "[inproc][mesh_node]") {
+    // messages from several senders arrive at the same time and are applied as one burst
+    auto network = std::make_shared<InProcNetwork>();
+    const auto make_relay = [network](const char* address, bool merge_forwards) {
+        std::unique_ptr<MeshNode> relay(new MeshNode(MeshNode::Config{
+                10,     // peer update interval
+                1000,   // entity expiry interval
+                8000,   // entity updates size
+                false,  // spectator
+                {},     // ego sphere
+                {address, address, {0, 0}},
+                std::make_shared<InProcTransport>(network, address),  // transport
+                nullptr,                                              // logger
+                [network]() { return network->getTime(); },          // local clock
+                64,                                                   // buffer pool size
+                0,                                                    // pipeline workers
+                1024,                                                 // pipeline queue size
+                64,                                                   // receive batch size
+                0,                                                    // forward coalesce ms
+                0,                                                    // update coalesce ms
+                0,                                                    // submit queue size
+                10,                                                   // submit interval ms
+                0,                                                    // lod distance
+                100,                                                  // lod interval ms
+                merge_forwards,                                       // merge forwards
+        }));
+        relay->getPeerTracker().latchPeer("sink");
+        return relay;
+    };
+    // peer updates are ignored, only messages carrying entities are kept
+    const auto add_receiver = [](InProcTransport& transport, std::vector<std::string>& rx_msgs) {
+        transport.addReceiver([&rx_msgs](const void* buffer, size_t len) {
+            auto entities = fb::GetRoot<Message>(buffer)->entities();
+            if (entities && entities->size()) {
+                rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+            }
+        });
+    };
+    auto relay = make_relay("relay", true);
+    relay->getPeerTracker().latchPeer("sender0");
+    InProcTransport sink(network, "sink");
+    std::vector<std::string> rx_msgs;
+    add_receiver(sink, rx_msgs);
+
+    // each sender relays one entity with its own timestamp and hops
+    const int n_senders = 5;
+    std::vector<std::unique_ptr<InProcTransport>> senders;
+    std::vector<std::string> sent_msgs;
+    std::vector<std::string> echo_msgs;
+    for (int i = 0; i < n_senders; ++i) {
+        std::string address = "sender" + std::to_string(i);
+        senders.emplace_back(new InProcTransport(network, address));
+        senders.back()->connect("relay");
+        MessageT msg;
+        msg.timestamp = 1000 + i;
+        msg.hops = 1 + i;
+        msg.source.reset(new NodeInfoT());
+        msg.source->address = address;
+        msg.source->coordinates = {1, (float) i};
+        msg.entities.emplace_back(new EntityT());
+        msg.entities.back()->name = "entity" + std::to_string(i);
+        msg.entities.back()->expiry = std::numeric_limits<int64_t>::max();
+        fb::FlatBufferBuilder fbb;
+        fbb.Finish(Message::Pack(fbb, &msg));
+        auto buffer = reinterpret_cast<const char*>(fbb.GetBufferPointer());
+        sent_msgs.emplace_back(buffer, fbb.GetSize());
+    }
+    add_receiver(*senders.front(), echo_msgs);
+    network->run(20);
+    REQUIRE(relay->getConnectedPeers().size() == 2);
+    for (int i = 0; i < n_senders; ++i) {
+        senders[i]->transmit(sent_msgs[i].data(), sent_msgs[i].size());
+    }
+    network->run(5);
+    REQUIRE(relay->getEntities().first.size() == n_senders);
+
+    // forwards are merged into one message
+    REQUIRE(rx_msgs.size() == 1);
+    auto msg = fb::GetRoot<Message>(rx_msgs.front().data());
+    REQUIRE(msg->entities()->size() == n_senders);
+    for (int i = 0; i < n_senders; ++i) {
+        auto entity = msg->entities()->Get(i);
+        REQUIRE(entityTimestamp(msg, entity) == 1000 + i);
+        REQUIRE(entityHops(msg, entity) == static_cast<uint32_t>(2 + i));
+    }
+
+    // a source gets the entities of the others but not its own back
+    REQUIRE(echo_msgs.size() == 1);
+    auto echo_msg = fb::GetRoot<Message>(echo_msgs.front().data());
+    REQUIRE(echo_msg->entities()->size() == n_senders - 1);
+    for (auto entity : *echo_msg->entities()) {
+        REQUIRE(entity->name()->str() != "entity0");
+    }
+
+    // another relay receiving the merged message recognizes the originals as duplicates
+    auto relay2 = make_relay("relay2", true);
+    network->run(20);
+    sink.connect("relay2");
+    sink.transmit(rx_msgs.front().data(), rx_msgs.front().size());
+    network->run(5);
+    REQUIRE(relay2->getEntities().first.size() == n_senders);
+    REQUIRE(rx_msgs.size() == 2);
+    for (auto& sender : senders) {
+        sender->connect("relay2");
+        sender->disconnect("relay");
+    }
+    for (int i = 0; i < n_senders; ++i) {
+        senders[i]->transmit(sent_msgs[i].data(), sent_msgs[i].size());
+    }
+    network->run(5);
+    REQUIRE(rx_msgs.size() == 2);
+
+    // without merging each message is forwarded on its own without entity offsets
+    auto relay3 = make_relay("relay3", false);
+    network->run(20);
+    rx_msgs.clear();
+    for (int i = 0; i < n_senders; ++i) {
+        senders[i]->connect("relay3");
+        senders[i]->transmit(sent_msgs[i].data(), sent_msgs[i].size());
+    }
+    network->run(5);
+    REQUIRE(relay3->getEntities().first.size() == n_senders);
+    REQUIRE(rx_msgs.size() == n_senders);
+    for (int i = 0; i < n_senders; ++i) {
+        auto forwarded = fb::GetRoot<Message>(rx_msgs[i].data());
+        REQUIRE(forwarded->timestamp() == 1000 + i);
+        REQUIRE(forwarded->hops() == static_cast<uint32_t>(2 + i));
+        REQUIRE(forwarded->entities()->size() == 1);
+        REQUIRE(forwarded->entities()->Get(0)->timestamp_offset() == 0);
+        REQUIRE(forwarded->entities()->Get(0)->hops_offset() == 0);
+    }
+}
+
+TEST_CASE("InProc MeshNode Forward Coalescing", "[inproc][mesh_node]") {
+    auto network = std::make_shared<InProcNetwork>();
+    const auto make_relay = [network](size_t entity_updates_size) {
+        return std::unique_ptr<MeshNode>(new MeshNode(MeshNode::Config{
+                1000,                 // peer update interval
+                1000,                 // entity expiry interval
+                entity_updates_size,  // entity updates size
+                false,                // spectator
+                {},                   // ego sphere
+                {"relay", "relay", {0, 0}},
+                std::make_shared<InProcTransport>(network, "relay"),  // transport
+                nullptr,                                              // logger
+                [network]() { return network->getTime(); },          // local clock
+                64,                                                   // buffer pool size
+                0,                                                    // pipeline workers
+                1024,                                                 // pipeline queue size
+                0,                                                    // receive batch size
+                50,                                                   // forward coalesce ms
+                0,                                                    // update coalesce ms
+                0,                                                    // submit queue size
+                10,                                                   // submit interval ms
+                0,                                                    // lod distance
+                100,                                                  // lod interval ms
+                true,                                                 // merge forwards
+        }));
+    };
+    InProcTransport sink(network, "sink");
+    std::vector<std::string> rx_msgs;
+    sink.addReceiver([&rx_msgs](const void* buffer, size_t len) {
+        rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+    });
+    InProcTransport sender(network, "sender");
+    sender.connect("relay");
+    const auto send_entity = [&](const std::string& name, uint8_t value) {
+        MessageT msg;
+        msg.timestamp = network->getTime() + 1;
+        msg.source.reset(new NodeInfoT());
+        msg.source->address = "sender";
+        msg.source->coordinates = {1, 0};
+        msg.entities.emplace_back(new EntityT());
+        msg.entities.back()->name = name;
+        msg.entities.back()->expiry = std::numeric_limits<int64_t>::max();
+        msg.entities.back()->data.assign(100, value);
+        fb::FlatBufferBuilder fbb;
+        fbb.Finish(Message::Pack(fbb, &msg));
+        sender.transmit(fbb.GetBufferPointer(), fbb.GetSize());
+    };
+
+    SECTION("Window") {
+        auto relay = make_relay(8000);
+        relay->getTransport().connect("sink");
+        // repeated updates of one entity within the window collapse to the newest
+        for (uint8_t i = 0; i < 3; ++i) {
+            send_entity("a", i);
+            network->run(10);
+        }
+        send_entity("b", 0);
+        network->run(10);
+        REQUIRE(rx_msgs.empty());
+        network->run(20);
+        REQUIRE(rx_msgs.size() == 1);
+        auto msg = fb::GetRoot<Message>(rx_msgs.front().data());
+        REQUIRE(msg->entities()->size() == 2);
+        REQUIRE(msg->entities()->Get(0)->name()->str() == "a");
+        REQUIRE(msg->entities()->Get(0)->data()->Get(0) == 2);
+        REQUIRE(msg->entities()->Get(1)->name()->str() == "b");
+        // nothing pending means nothing sent
+        network->run(100);
+        REQUIRE(rx_msgs.size() == 1);
+    }
+
+    SECTION("Full Message") {
+        // a full message worth of updates is sent without waiting for the window
+        auto relay = make_relay(500);
+        relay->getTransport().connect("sink");
+        for (int i = 0; i < 5; ++i) {
+            send_entity("entity" + std::to_string(i), 0);
+        }
+        network->run(10);
+        REQUIRE(rx_msgs.size() == 1);
+        REQUIRE(fb::GetRoot<Message>(rx_msgs.front().data())->entities()->size() >= 3);
+    }
+}
+
+TEST_CASE("InProc MeshNode Update Coalescing", "[inproc][mesh_node]") {
+    auto network = std::make_shared<InProcNetwork>();
+    MeshNode node(MeshNode::Config{
+            1000,  // peer update interval
+            1000,  // entity expiry interval
+            8000,  // entity updates size
+            false,  // spectator
+            {},     // ego sphere
+            {"node", "node", {0, 0}},
+            std::make_shared<InProcTransport>(network, "node"),  // transport
+            nullptr,                                             // logger
+            [network]() { return network->getTime(); },         // local clock
+            64,                                                  // buffer pool size
+            0,                                                   // pipeline workers
+            1024,                                                // pipeline queue size
+            0,                                                   // receive batch size
+            0,                                                   // forward coalesce ms
+            50,                                                  // update coalesce ms
+    });
+    node.getTransport().connect("sink");
+    InProcTransport sink(network, "sink");
+    std::vector<std::string> rx_msgs;
+    sink.addReceiver([&rx_msgs](const void* buffer, size_t len) {
+        rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+    });
+    const auto update_entity = [&node](const std::string& name, uint8_t value) {
+        std::vector<EntityT> entities(1);
+        entities.back().name = name;
+        entities.back().expiry = std::numeric_limits<int64_t>::max();
+        entities.back().data.assign(10, value);
+        return node.updateEntities(entities);
+    };
+    const auto check_entities = [&rx_msgs](uint8_t a_value) {
+        REQUIRE(rx_msgs.size() == 1);
+        auto msg = fb::GetRoot<Message>(rx_msgs.front().data());
+        REQUIRE(msg->entities()->size() == 2);
+        REQUIRE(msg->entities()->Get(0)->name()->str() == "a");
+        REQUIRE(msg->entities()->Get(0)->data()->Get(0) == a_value);
+        REQUIRE(msg->entities()->Get(1)->name()->str() == "b");
+        rx_msgs.clear();
+    };
+
+    // several updates per interval only send the latest state of each entity
+    for (uint8_t i = 0; i < 4; ++i) {
+        REQUIRE(update_entity("a", i).empty());
+        if (i == 1) {
+            REQUIRE(update_entity("b", i).empty());
+        }
+        network->run(10);
+    }
+    REQUIRE(rx_msgs.empty());
+    REQUIRE(node.getEntities().first.empty());
+    network->run(20);
+    check_entities(3);
+    REQUIRE(node.getEntities().first.size() == 2);
+
+    // nothing staged means nothing sent
+    network->run(100);
+    REQUIRE(rx_msgs.empty());
+
+    // flushed on demand, entities keep the order they were first staged in
+    update_entity("a", 4);
+    update_entity("b", 0);
+    update_entity("a", 5);
+    node.flushEntityUpdates();
+    network->run(1);
+    check_entities(5);
+}
+
+TEST_CASE("InProc MeshNode Submit", "[inproc][mesh_node]") {
+    auto network = std::make_shared<InProcNetwork>();
+    // drops are logged by the polling thread, never by producers
+    auto logger = std::make_shared<Logger>();
+    const auto polling_thread = std::this_thread::get_id();
+    std::atomic<bool> logged_elsewhere{false};
+    std::vector<size_t> drops;
+    logger->addLogHandler(Logger::WARN,
+            [&](int64_t, Logger::Level, Error error, const void* data, size_t len) {
+                if (std::this_thread::get_id() != polling_thread) {
+                    logged_elsewhere = true;
+                    return;
+                }
+                if (error.type == MeshNode::SUBMIT_QUEUE_FULL && len == sizeof(size_t)) {
+                    drops.push_back(*static_cast<const size_t*>(data));
+                }
+            });
+    MeshNode node(MeshNode::Config{
+            1000,  // peer update interval
+            1000,  // entity expiry interval
+            8000,  // entity updates size
+            false,  // spectator
+            {},     // ego sphere
+            {"node", "node", {0, 0}},
+            std::make_shared<InProcTransport>(network, "node"),  // transport
+            logger,                                              // logger
+            [network]() { return network->getTime(); },         // local clock
+            64,                                                  // buffer pool size
+            0,                                                   // pipeline workers
+            1024,                                                // pipeline queue size
+            0,                                                   // receive batch size
+            0,                                                   // forward coalesce ms
+            0,                                                   // update coalesce ms
+            64,                                                  // submit queue size
+            10,                                                  // submit interval ms
+    });
+    node.getTransport().connect("sink");
+    InProcTransport sink(network, "sink");
+    size_t rx_entities = 0;
+    sink.addReceiver([&rx_entities](const void* buffer, size_t) {
+        rx_entities += fb::GetRoot<Message>(buffer)->entities()->size();
+    });
+
+    // producers only queue entities, nothing is sent until the polling thread drains them
+    const size_t n_producers = 4;
+    std::vector<size_t> n_submitted(n_producers);
+    std::vector<std::thread> producers;
+    for (size_t producer = 0; producer < n_producers; ++producer) {
+        producers.emplace_back([&node, &n_submitted, producer]() {
+            std::vector<EntityT> entities(8);
+            for (size_t i = 0; i < entities.size(); ++i) {
+                entities[i].name = std::to_string(producer) + "_" + std::to_string(i);
+                entities[i].expiry = std::numeric_limits<int64_t>::max();
+            }
+            n_submitted[producer] = node.submitEntities(entities);
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    REQUIRE(n_submitted == std::vector<size_t>(n_producers, 8));
+    REQUIRE(node.getEntities().first.empty());
+    network->run(15);
+    REQUIRE(node.getEntities().first.size() == 32);
+    REQUIRE(rx_entities == 32);
+
+    // entities past the queue capacity are rejected instead of blocking
+    std::vector<EntityT> entities(100);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = "overflow_" + std::to_string(i);
+        entities[i].expiry = std::numeric_limits<int64_t>::max();
+    }
+    REQUIRE(node.submitEntities(entities) == 64);
+    REQUIRE(drops.empty());
+    network->run(10);
+    REQUIRE(node.getEntities().first.size() == 96);
+    REQUIRE(rx_entities == 96);
+    REQUIRE(drops == std::vector<size_t>{36});
+    REQUIRE_FALSE(logged_elsewhere);
+}
+
+TEST_CASE("InProc MeshNode Level Of Detail", "[inproc][mesh_node]") {
+    // peers on either side of the source, only one is within level of detail distance
+    auto network = std::make_shared<InProcNetwork>();
+    std::map<std::string, size_t> rx_updates;
+    std::deque<MeshNode> mesh_nodes;
+    for (auto node : std::vector<std::pair<std::string, float>>{
+                 {"source", 0}, {"near", 1}, {"far", -20}}) {
+        const auto& address = node.first;
+        EgoSphere::Config ego_sphere;
+        ego_sphere.entity_update_handler = [&rx_updates, address](
+                                                   const EgoSphere::EntityUpdate*,
+                                                   const EgoSphere::EntityUpdate*,
+                                                   const NodeInfoT&) {
+            ++rx_updates[address];
+            return true;
+        };
+        mesh_nodes.emplace_back(MeshNode::Config{
+                100,         // peer update interval
+                1000,        // entity expiry interval
+                8000,        // entity updates size
+                false,       // spectator
+                ego_sphere,  // ego sphere
+                {address, address, {node.second, 0}},
+                std::make_shared<InProcTransport>(network, address),  // transport
+                nullptr,                                              // logger
+                [network]() { return network->getTime(); },          // local clock
+                64,                                                   // buffer pool size
+                0,                                                    // pipeline workers
+                1024,                                                 // pipeline queue size
+                0,                                                    // receive batch size
+                0,                                                    // forward coalesce ms
+                0,                                                    // update coalesce ms
+                0,                                                    // submit queue size
+                10,                                                   // submit interval ms
+                10,                                                   // lod distance
+                100,                                                  // lod interval ms
+        });
+        mesh_nodes.back().getPeerTracker().latchPeer("source", 1);
+    }
+    network->run(1000);
+    REQUIRE(mesh_nodes[0].getConnectedPeers().size() == 2);
+    rx_updates.clear();
+
+    // far peer gets about one update per interval, near peer gets all of them
+    EntityT entity;
+    entity.name = "entity";
+    entity.coordinates = {0, 0};
+    entity.expiry = std::numeric_limits<int64_t>::max();
+    for (int i = 0; i < 100; ++i) {
+        mesh_nodes[0].updateEntities({entity});
+        network->run(10);
+    }
+    REQUIRE(rx_updates["near"] == 100);
+    REQUIRE(rx_updates["far"] >= 9);
+    REQUIRE(rx_updates["far"] <= 11);
+}
@@ -4,6 +4,7 @@
 #include <vsm/graphviz.hpp>
 #include <vsm/time_sync.hpp>
 
+#include <algorithm>
 #include <deque>
 #include <iostream>
 
@@ -226,3 +227,157 @@ TEST_CASE("MeshNode Graph", "[mesh_node]") {
     }
 #endif
 }
+
+TEST_CASE("MeshNode Pass Through Forwarding", "[mesh_node]") {
+    MeshNode mesh_node({
+            1000,   // peer update interval
+            1000,   // entity expiry interval
+            8000,   // entity updates size
+            false,  // spectator
+            {},     // ego sphere
+            {
+                    "relay",                  // name
+                    "udp://127.0.0.1:11711",  // address
+                    {0, 0},                   // coordinates
+            },
+            std::make_shared<ZmqTransport>("udp://*:11711"),  // transport
+            std::make_shared<Logger>(),                       // logger
+    });
+    auto& self = mesh_node.getPeerTracker().getNodeInfo();
+
+    // message from a remote source with entities of various sizes
+    NodeInfoT source;
+    source.name = "remote_name";
+    source.address = "udp://127.0.0.1:11712";
+    source.coordinates = {1, 2};
+    std::vector<EntityT> entities(3);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = std::string(i + 1, 'a' + i);
+        entities[i].expiry = std::numeric_limits<int64_t>::max();
+        entities[i].data.assign(3 * i + 1, i);
+    }
+    entities[2].coordinates = {1, 1};
+    fb::FlatBufferBuilder fbb_in, fbb_out;
+    auto make_message = [&](int64_t timestamp, uint32_t hops) {
+        std::vector<fb::Offset<Entity>> entity_offsets;
+        for (const auto& entity : entities) {
+            entity_offsets.emplace_back(Entity::Pack(fbb_in, &entity));
+        }
+        fbb_in.Finish(CreateMessage(fbb_in, timestamp, hops, NodeInfo::Pack(fbb_in, &source), {},
+                fbb_in.CreateVector(entity_offsets)));
+    };
+    auto check_forwarded = [&](const Message* msg, int64_t timestamp, uint32_t hops) {
+        REQUIRE(msg);
+        fb::Verifier verifier(fbb_out.GetBufferPointer(), fbb_out.GetSize());
+        REQUIRE(msg->Verify(verifier));
+        REQUIRE(msg->timestamp() == timestamp);
+        REQUIRE(msg->hops() == hops);
+        REQUIRE(msg->source()->address()->str() == self.address);
+        REQUIRE(msg->source()->name()->str() == self.name);
+        REQUIRE(msg->source()->sequence() == self.sequence);
+        REQUIRE(msg->entities()->size() == entities.size());
+        for (size_t i = 0; i < entities.size(); ++i) {
+            EntityT entity;
+            msg->entities()->Get(i)->UnPackTo(&entity);
+            REQUIRE(entity.name == entities[i].name);
+            REQUIRE(entity.data == entities[i].data);
+            REQUIRE(entity.coordinates == entities[i].coordinates);
+        }
+        // hops must be stored so the next relay can patch it
+        REQUIRE(fb::GetMutableRoot<Message>(fbb_out.GetBufferPointer())->mutate_hops(hops));
+    };
+    // a pass through keeps the received bytes, so the replaced source name is still in there
+    auto passed_through = [&]() {
+        auto out = reinterpret_cast<const char*>(fbb_out.GetBufferPointer());
+        auto out_end = out + fbb_out.GetSize();
+        return std::search(out, out_end, source.name.begin(), source.name.end()) != out_end;
+    };
+    auto hops_stored = [&]() {
+        auto msg = fb::GetRoot<Message>(fbb_in.GetBufferPointer());
+        return reinterpret_cast<const fb::Table*>(msg)->GetOptionalFieldOffset(Message::VT_HOPS);
+    };
+
+    // all entities accepted, passed through with hops and source patched
+    make_message(1, 3);
+    REQUIRE(hops_stored());
+    auto msg = mesh_node.forwardEntityUpdates(fbb_out, fbb_in.GetBufferPointer(), fbb_in.GetSize());
+    check_forwarded(msg, 1, 4);
+    REQUIRE(passed_through());
+    fbb_in.Clear();
+
+    // hops equal to the schema default of 1 is left out of the table by the builder, so there is
+    // nothing to patch and the message falls back to a rebuilt copy with hops stored
+    make_message(2, 1);
+    REQUIRE_FALSE(hops_stored());
+    msg = mesh_node.forwardEntityUpdates(fbb_out, fbb_in.GetBufferPointer(), fbb_in.GetSize());
+    check_forwarded(msg, 2, 2);
+    REQUIRE_FALSE(passed_through());
+    fbb_in.Clear();
+
+    // forwarded message can itself be passed through by another relay
+    std::vector<uint8_t> forwarded(
+            fbb_out.GetBufferPointer(), fbb_out.GetBufferPointer() + fbb_out.GetSize());
+    fb::GetMutableRoot<Message>(forwarded.data())->mutate_timestamp(3);
+    msg = mesh_node.forwardEntityUpdates(fbb_out, forwarded.data(), forwarded.size());
+    check_forwarded(msg, 3, 3);
+
+    // partially accepted message is rebuilt with only the accepted entities
+    auto all_entities = entities;
+    entities.resize(1);
+    make_message(4, 3);
+    REQUIRE(mesh_node.forwardEntityUpdates(fbb_out, fbb_in.GetBufferPointer(), fbb_in.GetSize()));
+    fbb_in.Clear();
+    entities = all_entities;
+    make_message(4, 3);
+    msg = mesh_node.forwardEntityUpdates(fbb_out, fbb_in.GetBufferPointer(), fbb_in.GetSize());
+    REQUIRE(msg);
+    REQUIRE(msg->hops() == 4);
+    REQUIRE(msg->entities()->size() == 2);
+    REQUIRE(msg->entities()->Get(0)->name()->str() == entities[1].name);
+}
+
+TEST_CASE("MeshNode Buffer Reuse", "[mesh_node]") {
+    auto mesh_node_ptr = std::make_unique<MeshNode>(MeshNode::Config{
+            1000,   // peer update interval
+            1000,   // entity expiry interval
+            8000,   // entity updates size
+            false,  // spectator
+            {},     // ego sphere
+            {
+                    "node",                   // name
+                    "udp://127.0.0.1:11721",  // address
+                    {0, 0},                   // coordinates
+            },
+            std::make_shared<ZmqTransport>("udp://*:11721"),  // transport
+            std::make_shared<Logger>(),                       // logger
+    });
+    auto& mesh_node = *mesh_node_ptr;
+    std::vector<EntityT> entities(100);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        entities[i].name = "entity" + std::to_string(i);
+        entities[i].expiry = std::numeric_limits<int64_t>::max();
+        entities[i].data.assign(100, i);
+    }
+    // entities are split across several messages
+    std::vector<MessageBuffer> msgs;
+    mesh_node.updateEntities(msgs, entities);
+    REQUIRE(msgs.size() > 1);
+    for (auto& msg : msgs) {
+        REQUIRE(msg.get()->entities()->size() > 0);
+    }
+    // once warmed up, released message buffers are recycled instead of allocated
+    auto allocations = mesh_node.getBufferPool().getStats().allocations;
+    for (int i = 0; i < 10; ++i) {
+        for (auto& entity : entities) {
+            entity.data[0] = i;
+        }
+        mesh_node.updateEntities(msgs, entities);
+    }
+    REQUIRE(mesh_node.getBufferPool().getStats().allocations == allocations);
+    REQUIRE(mesh_node.getBufferPool().getStats().reuses > 0);
+    // message buffers keep the pool alive after the node is gone
+    auto returned_msgs = mesh_node.updateEntities(entities);
+    mesh_node_ptr.reset();
+    REQUIRE(!returned_msgs.empty());
+    REQUIRE(returned_msgs.front().get()->entities()->size() > 0);
+}
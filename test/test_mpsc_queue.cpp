@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+#include <vsm/mpsc_queue.hpp>
+
+#include <thread>
+
+using namespace vsm;
+
+TEST_CASE("MPSC Queue", "[mpsc_queue]") {
+    MpscQueue<std::vector<int>> queue(3);
+    REQUIRE(queue.capacity() == 4);
+    REQUIRE(queue.front() == nullptr);
+
+    // fill until full
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.push(std::vector<int>(10, i)));
+    }
+    REQUIRE_FALSE(queue.push(std::vector<int>()));
+    REQUIRE(queue.size() == 4);
+
+    // drain in order
+    for (int i = 0; i < 4; ++i) {
+        auto slot = queue.front();
+        REQUIRE(slot);
+        REQUIRE(slot->front() == i);
+        queue.pop();
+    }
+    REQUIRE(queue.front() == nullptr);
+    REQUIRE(queue.size() == 0);
+
+    // wraps around to reuse popped slots
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.push(std::vector<int>(1, i)));
+    }
+    REQUIRE(queue.front()->front() == 0);
+}
+
+TEST_CASE("MPSC Queue Threads", "[mpsc_queue]") {
+    MpscQueue<size_t> queue(64);
+    const size_t n_producers = 4;
+    const size_t n_items = 50000;
+    // each producer tags its items so their order can be checked per producer
+    std::vector<std::thread> producers;
+    for (size_t producer = 0; producer < n_producers; ++producer) {
+        producers.emplace_back([&queue, producer, n_items]() {
+            for (size_t i = 0; i < n_items;) {
+                if (queue.push(i * n_producers + producer)) {
+                    ++i;
+                }
+            }
+        });
+    }
+    std::vector<size_t> expected(n_producers, 0);
+    bool in_order = true;
+    for (size_t received = 0; received < n_producers * n_items;) {
+        if (auto slot = queue.front()) {
+            auto& next = expected[*slot % n_producers];
+            in_order &= *slot / n_producers == next++;
+            queue.pop();
+            ++received;
+        }
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    REQUIRE(in_order);
+    REQUIRE(expected == std::vector<size_t>(n_producers, n_items));
+    REQUIRE(queue.size() == 0);
+}
@@ -40,6 +40,39 @@ TEST_CASE("NodeInfo Serialization", "[flatbuffers][peer_tracker]") {
     REQUIRE(peer_tracker.updatePeer(node_info) == PeerTracker::SUCCESS);
     REQUIRE(peer_tracker.getPeers().size() == 1);
     REQUIRE(peer_tracker.getPeers().at("peer_addr").node_info.name == "peer_name");
+
+    // embed cached self node info into a message
+    auto check_source = [&](uint32_t sequence, const char* name, std::vector<float> coords) {
+        FlatBufferBuilder msg_fbb;
+        auto entities = msg_fbb.CreateVector(std::vector<Offset<Entity>>{});
+        auto source = peer_tracker.copyNodeInfo(msg_fbb);
+        msg_fbb.Finish(CreateMessage(msg_fbb, 1, 2, source, 0, entities));
+        Verifier msg_verifier(msg_fbb.GetBufferPointer(), msg_fbb.GetSize());
+        auto msg = GetRoot<Message>(msg_fbb.GetBufferPointer());
+        REQUIRE(msg->Verify(msg_verifier));
+        REQUIRE(msg->timestamp() == 1);
+        REQUIRE(msg->hops() == 2);
+        REQUIRE(msg->source()->address()->str() == "address");
+        REQUIRE(msg->source()->name()->str() == name);
+        REQUIRE(msg->source()->sequence() == sequence);
+        REQUIRE(distanceSqr(*msg->source()->coordinates(), coords) == 0);
+    };
+    check_source(0, "name", {0, 0});
+    const uint8_t* cached = peer_tracker.getNodeInfoBuffer().GetBufferPointer();
+    check_source(0, "name", {0, 0});
+    REQUIRE(peer_tracker.getNodeInfoBuffer().GetBufferPointer() == cached);
+    // rebuilt on sequence ticks and setter changes
+    std::vector<std::string> selected_peers, recipients;
+    peer_tracker.updatePeerSelections(selected_peers, recipients);
+    check_source(1, "name", {0, 0});
+    peer_tracker.setCoordinates({1, 2});
+    check_source(1, "name", {1, 2});
+    peer_tracker.setName("new_name");
+    check_source(1, "new_name", {1, 2});
+    peer_tracker.setGroupMask(2);
+    check_source(1, "new_name", {1, 2});
+    auto packed = GetRoot<NodeInfo>(peer_tracker.getNodeInfoBuffer().GetBufferPointer());
+    REQUIRE(packed->group_mask() == 2);
 }
 
 TEST_CASE("Peer Ranking", "[peer_tracker]") {
@@ -131,4 +164,166 @@ TEST_CASE("Nearest Peer", "[peer_tracker]") {
     REQUIRE(peer_tracker.nearestPeer(std::vector<float>{2, 2}, pool).name == "3");
     REQUIRE(peer_tracker.nearestPeer(std::vector<float>{4, 5}, pool).name == "5");
     REQUIRE(peer_tracker.nearestPeer(std::vector<float>{10, 100}, pool).name == "8");
+
+    // packed lookup matches the per query lookup
+    peer_tracker.setNearestPeers(pool);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-20, 20);
+    const auto require_match = [&]() {
+        for (int i = 0; i < 100; ++i) {
+            std::vector<float> coordinates{dis(gen), dis(gen)};
+            REQUIRE(peer_tracker.nearestPeer(coordinates).address ==
+                    peer_tracker.nearestPeer(coordinates, pool).address);
+        }
+    };
+    require_match();
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{2, 2}).name == "3");
+    // peer updates are reflected once the nearest peers are set again
+    NodeInfoT peer;
+    peer.name = "3";
+    peer.address = "3";
+    peer.coordinates = {-4, -5};
+    peer.sequence = 100;
+    fbb.Finish(NodeInfo::Pack(fbb, &peer));
+    REQUIRE(peer_tracker.updatePeer(GetRoot<NodeInfo>(fbb.GetBufferPointer())) ==
+            PeerTracker::SUCCESS);
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{-4, -5}).name == "my_name");
+    peer_tracker.setNearestPeers(pool);
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{-4, -5}).name == "3");
+    require_match();
+    // more peers than fit in one packed block
+    pool = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10"};
+    peer_tracker.setNearestPeers(pool);
+    require_match();
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{10, 100}).name == "10");
+    // mismatched dimensions fall back to self
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{0, 0, 0}).name == "my_name");
+    // empty set only contains self
+    peer_tracker.setNearestPeers({});
+    REQUIRE(peer_tracker.nearestPeer(std::vector<float>{4, 5}).name == "my_name");
+}
+
+TEST_CASE("Incremental Peer Selection", "[peer_tracker]") {
+    PeerTracker::Config config{
+            "my_name",     // name
+            "my_address",  // address
+            {0, 0},        // coordinates
+    };
+    PeerTracker peer_tracker(config);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> action(0, 9);
+
+    FlatBufferBuilder fbb;
+    std::vector<NodeInfoT> peers;
+    auto update_peer = [&](PeerTracker& tracker, const NodeInfoT& peer) {
+        fbb.Clear();
+        fbb.Finish(NodeInfo::Pack(fbb, &peer));
+        REQUIRE(tracker.updatePeer(GetRoot<NodeInfo>(fbb.GetBufferPointer())) ==
+                PeerTracker::SUCCESS);
+    };
+    std::vector<std::string> selected_peers, recipients;
+    std::vector<std::string> expected_peers, expected_recipients;
+    for (int tick = 0; tick < 200; ++tick) {
+        // add peers
+        for (int i = action(gen) / 3; i > 0; --i) {
+            peers.emplace_back();
+            peers.back().address = "address" + std::to_string(peers.size());
+            peers.back().coordinates = {dis(gen), dis(gen)};
+            update_peer(peer_tracker, peers.back());
+        }
+        // randomly move, leave or rejoin group, or stay
+        for (auto& peer : peers) {
+            switch (action(gen)) {
+                case 0:
+                    peer.coordinates = {dis(gen), dis(gen)};
+                    break;
+                case 1:
+                    peer.group_mask = ~peer.group_mask;
+                    break;
+                default:
+                    continue;
+            }
+            ++peer.sequence;
+            update_peer(peer_tracker, peer);
+        }
+        // occasionally move self
+        if (action(gen) == 0) {
+            config.coordinates = {dis(gen) / 2, dis(gen) / 2};
+            peer_tracker.setCoordinates(config.coordinates);
+        }
+        peer_tracker.updatePeerSelections(selected_peers, recipients);
+
+        // compare against selections computed from scratch
+        PeerTracker reference(config);
+        for (const auto& peer : peers) {
+            update_peer(reference, peer);
+        }
+        // first tick selects everything since peers start latched until sequence 0
+        reference.updatePeerSelections(expected_peers, expected_recipients);
+        reference.updatePeerSelections(expected_peers, expected_recipients);
+        std::sort(selected_peers.begin(), selected_peers.end());
+        std::sort(expected_peers.begin(), expected_peers.end());
+        REQUIRE(selected_peers == expected_peers);
+        REQUIRE(recipients == expected_recipients);
+    }
+    REQUIRE(peers.size() > 100);
+}
+
+TEST_CASE("Co-located Peer Selection", "[peer_tracker]") {
+    PeerTracker::Config config{
+            "my_name",     // name
+            "my_address",  // address
+            {0, 0},        // coordinates
+    };
+    PeerTracker peer_tracker(config);
+    FlatBufferBuilder fbb;
+    std::vector<NodeInfoT> peers;
+    auto add_peer = [&](const std::string& address, std::vector<float> coordinates) {
+        peers.emplace_back();
+        peers.back().address = address;
+        peers.back().coordinates = std::move(coordinates);
+        fbb.Clear();
+        fbb.Finish(NodeInfo::Pack(fbb, &peers.back()));
+        REQUIRE(peer_tracker.updatePeer(GetRoot<NodeInfo>(fbb.GetBufferPointer())) ==
+                PeerTracker::SUCCESS);
+    };
+    // every peer whose point is on the hull is selected, as with the point set hull
+    auto expected_peers = [&]() {
+        std::vector<QuickHull::Point> points;
+        for (const auto& peer : peers) {
+            points.push_back(peer.coordinates);
+        }
+        QuickHull::sphereInversion(points, config.coordinates);
+        points.emplace_back(config.coordinates.size(), 0);
+        auto hull = QuickHull::convexHull(points);
+        std::vector<std::string> expected;
+        for (size_t i = 0; i < peers.size(); ++i) {
+            if (hull.count(points[i])) {
+                expected.push_back(peers[i].address);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        return expected;
+    };
+    std::vector<std::string> selected_peers, recipients;
+    auto select = [&]() {
+        peer_tracker.updatePeerSelections(selected_peers, recipients);
+        std::sort(selected_peers.begin(), selected_peers.end());
+        return selected_peers;
+    };
+    add_peer("a", {1, 0});
+    add_peer("b", {1, 0});
+    add_peer("c", {0, 1});
+    add_peer("d", {-1, -1});
+    add_peer("e", {3, 3});
+    // first tick selects everything since peers start latched until sequence 0
+    select();
+    REQUIRE(select() == expected_peers());
+    REQUIRE(std::count(selected_peers.begin(), selected_peers.end(), "a"));
+    REQUIRE(std::count(selected_peers.begin(), selected_peers.end(), "b"));
+    // joining an existing hull vertex extends the previous hull
+    add_peer("f", {1, 0});
+    REQUIRE(select() == expected_peers());
+    REQUIRE(std::count(selected_peers.begin(), selected_peers.end(), "f"));
 }
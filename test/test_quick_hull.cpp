@@ -171,3 +171,151 @@ TEST_CASE("Zero Distance Interior", "[quick_hull]") {
         REQUIRE(hull_points_with_origin.count(hull_point));
     }
 }
+
+TEST_CASE("Flat Point Buffer", "[quick_hull]") {
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+    size_t n_points = 1000;
+    size_t n_dims;
+    SECTION("2D") { n_dims = 2; }
+    SECTION("3D") { n_dims = 3; }
+    SECTION("4D") { n_dims = 4; }
+
+    std::vector<float> flat_points(n_points * n_dims);
+    for (auto& coord : flat_points) {
+        coord = dis(gen);
+    }
+    // point at inverted origin is always part of the hull
+    std::fill_n(flat_points.begin() + 10 * n_dims, n_dims, std::numeric_limits<float>::max());
+    std::vector<QuickHull::Point> points;
+    for (size_t i = 0; i < n_points; ++i) {
+        auto point = flat_points.begin() + i * n_dims;
+        points.emplace_back(point, point + n_dims);
+    }
+
+    // indices match the point set interface
+    auto hull_points = QuickHull::convexHull(points);
+    auto hull_indices = QuickHull::convexHull(flat_points.data(), n_points, n_dims);
+    REQUIRE(std::is_sorted(hull_indices.begin(), hull_indices.end()));
+    REQUIRE(hull_indices.size() == hull_points.size());
+    for (auto index : hull_indices) {
+        REQUIRE(hull_points.count(points[index]));
+    }
+    REQUIRE(std::binary_search(hull_indices.begin(), hull_indices.end(), 10));
+
+    // fewer points than required for a simplex are all part of the hull
+    REQUIRE(QuickHull::convexHull(flat_points.data(), n_dims, n_dims).size() == n_dims);
+    REQUIRE(QuickHull::convexHull(flat_points.data(), 0, n_dims).empty());
+    REQUIRE(QuickHull::convexHull(nullptr, n_points, n_dims).empty());
+}
+
+TEST_CASE("Low Dimension Kernels", "[quick_hull]") {
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+    SECTION("Brute Force 2D") {
+        // edges with every other point strictly on one side connect two hull vertices
+        const size_t n_points = 50;
+        std::vector<float> points(n_points * 2);
+        for (auto& coord : points) {
+            coord = dis(gen);
+        }
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < n_points; ++i) {
+            for (size_t j = 0; j < n_points; ++j) {
+                const float* a = &points[2 * i];
+                const float* b = &points[2 * j];
+                bool supporting = i != j;
+                for (size_t k = 0; supporting && k < n_points; ++k) {
+                    const float* p = &points[2 * k];
+                    supporting = k == i || k == j ||
+                                 (b[0] - a[0]) * (p[1] - a[1]) - (b[1] - a[1]) * (p[0] - a[0]) > 0;
+                }
+                if (supporting) {
+                    expected.push_back(i);
+                }
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        REQUIRE(QuickHull::convexHull(points.data(), n_points, 2) == expected);
+    }
+
+    SECTION("Brute Force 3D") {
+        // faces with every other point strictly on one side connect three hull vertices
+        const size_t n_points = 40;
+        std::vector<float> points(n_points * 3);
+        for (auto& coord : points) {
+            coord = dis(gen);
+        }
+        const auto side = [&](size_t i, size_t j, size_t k, size_t l) {
+            const float* a = &points[3 * i];
+            float u[3], v[3], w[3];
+            for (int d = 0; d < 3; ++d) {
+                u[d] = points[3 * j + d] - a[d];
+                v[d] = points[3 * k + d] - a[d];
+                w[d] = points[3 * l + d] - a[d];
+            }
+            return (u[1] * v[2] - u[2] * v[1]) * w[0] + (u[2] * v[0] - u[0] * v[2]) * w[1] +
+                   (u[0] * v[1] - u[1] * v[0]) * w[2];
+        };
+        std::vector<size_t> expected;
+        for (size_t i = 0; i < n_points; ++i) {
+            for (size_t j = i + 1; j < n_points; ++j) {
+                for (size_t k = j + 1; k < n_points; ++k) {
+                    int above = 0, below = 0;
+                    for (size_t l = 0; l < n_points; ++l) {
+                        if (l != i && l != j && l != k) {
+                            (side(i, j, k, l) > 0 ? above : below) += 1;
+                        }
+                    }
+                    if (!above || !below) {
+                        expected.insert(expected.end(), {i, j, k});
+                    }
+                }
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+        REQUIRE(QuickHull::convexHull(points.data(), n_points, 3) == expected);
+    }
+
+    SECTION("Lattice 2D") {
+        // only corners are vertices, edge points are coplanar and the center is interior
+        std::vector<float> points;
+        for (int x = 0; x < 3; ++x) {
+            for (int y = 0; y < 3; ++y) {
+                points.insert(points.end(), {float(x), float(y)});
+            }
+        }
+        REQUIRE(QuickHull::convexHull(points.data(), 9, 2) == std::vector<size_t>{0, 2, 6, 8});
+        REQUIRE(QuickHull::convexHull(points.data(), 9, 2, true).size() == 8);
+        // collinear input has no 2D hull
+        REQUIRE(QuickHull::convexHull(points.data(), 3, 2).empty());
+    }
+
+    SECTION("Lattice 3D") {
+        std::vector<float> points;
+        for (int x = 0; x < 3; ++x) {
+            for (int y = 0; y < 3; ++y) {
+                for (int z = 0; z < 3; ++z) {
+                    points.insert(points.end(), {float(x), float(y), float(z)});
+                }
+            }
+        }
+        REQUIRE(QuickHull::convexHull(points.data(), 27, 3) ==
+                std::vector<size_t>{0, 2, 6, 8, 18, 20, 24, 26});
+        auto coplanar_indices = QuickHull::convexHull(points.data(), 27, 3, true);
+        REQUIRE(coplanar_indices.size() == 26);
+        REQUIRE(!std::binary_search(coplanar_indices.begin(), coplanar_indices.end(), 13));
+        // coplanar input falls back to the hull of the leading two dimensions
+        std::vector<float> plane;
+        for (size_t i = 0; i < points.size(); i += 3) {
+            if (points[i + 2] == 0) {
+                plane.insert(plane.end(), points.begin() + i, points.begin() + i + 3);
+            }
+        }
+        REQUIRE(QuickHull::convexHull(plane.data(), 9, 3) == std::vector<size_t>{0, 2, 6, 8});
+    }
+}
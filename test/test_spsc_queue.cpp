@@ -0,0 +1,56 @@
+#include <catch2/catch.hpp>
+#include <vsm/spsc_queue.hpp>
+
+#include <thread>
+
+using namespace vsm;
+
+TEST_CASE("SPSC Queue", "[spsc_queue]") {
+    SpscQueue<std::vector<int>> queue(3);
+    REQUIRE(queue.capacity() == 4);
+    REQUIRE(queue.front() == nullptr);
+
+    // fill until full
+    for (int i = 0; i < 4; ++i) {
+        auto slot = queue.back();
+        REQUIRE(slot);
+        slot->assign(10, i);
+        queue.push();
+    }
+    REQUIRE(queue.back() == nullptr);
+    REQUIRE(queue.size() == 4);
+
+    // drain in order, popped slots keep their storage for the next push
+    for (int i = 0; i < 4; ++i) {
+        auto slot = queue.front();
+        REQUIRE(slot);
+        REQUIRE(slot->front() == i);
+        queue.pop();
+    }
+    REQUIRE(queue.front() == nullptr);
+    REQUIRE(queue.back()->capacity() >= 10);
+}
+
+TEST_CASE("SPSC Queue Threads", "[spsc_queue]") {
+    SpscQueue<size_t> queue(64);
+    const size_t n_items = 100000;
+    std::thread producer([&queue, n_items]() {
+        for (size_t i = 0; i < n_items;) {
+            if (auto slot = queue.back()) {
+                *slot = i++;
+                queue.push();
+            }
+        }
+    });
+    size_t expected = 0;
+    bool in_order = true;
+    while (expected < n_items) {
+        if (auto slot = queue.front()) {
+            in_order &= *slot == expected++;
+            queue.pop();
+        }
+    }
+    producer.join();
+    REQUIRE(in_order);
+    REQUIRE(queue.size() == 0);
+}
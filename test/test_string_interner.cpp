@@ -0,0 +1,60 @@
+#include <catch2/catch.hpp>
+#include <vsm/string_interner.hpp>
+
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace vsm;
+
+TEST_CASE("String Interner", "[string_interner]") {
+    StringInterner interner;
+    REQUIRE(interner.find("a", 1) == StringInterner::INVALID_ID);
+
+    // ids are dense and stable while interned
+    REQUIRE(interner.intern("a", 1) == 0);
+    REQUIRE(interner.intern(std::string("bb")) == 1);
+    REQUIRE(interner.intern("a", 1) == 0);
+    REQUIRE(interner.find("bb", 2) == 1);
+    REQUIRE(interner.find("b", 1) == StringInterner::INVALID_ID);
+    REQUIRE(interner.str(1) == "bb");
+    REQUIRE(interner.size() == 2);
+
+    // lookup from a non null terminated view
+    const char* text = "abba";
+    REQUIRE(interner.find(text + 1, 2) == 1);
+
+    // released ids are recycled
+    interner.release(0);
+    REQUIRE(interner.find("a", 1) == StringInterner::INVALID_ID);
+    REQUIRE(interner.size() == 1);
+    REQUIRE(interner.intern("c", 1) == 0);
+    REQUIRE(interner.idBound() == 2);
+
+    // random inserts and releases match a reference map through growth
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int> dis(0, 999);
+    std::unordered_map<std::string, uint32_t> reference;
+    interner.clear();
+    for (int i = 0; i < 20000; ++i) {
+        auto name = "entity" + std::to_string(dis(gen));
+        auto entry = reference.find(name);
+        if (entry == reference.end()) {
+            auto id = interner.intern(name);
+            REQUIRE(id < interner.idBound());
+            reference.emplace(name, id);
+        } else if (i % 3) {
+            REQUIRE(interner.find(name) == entry->second);
+        } else {
+            interner.release(entry->second);
+            reference.erase(entry);
+        }
+        REQUIRE(interner.size() == reference.size());
+    }
+    for (const auto& entry : reference) {
+        REQUIRE(interner.find(entry.first) == entry.second);
+        REQUIRE(interner.str(entry.second) == entry.first);
+    }
+    // ids never exceed the peak number of interned strings
+    REQUIRE(interner.idBound() <= 1000);
+}
@@ -0,0 +1,181 @@
+#include <catch2/catch.hpp>
+#include <vsm/udp_transport.hpp>
+#include <vsm/zmq_transport.hpp>
+
+#include <memory>
+
+using namespace vsm;
+
+TEST_CASE("UDP Transport Loopback", "[udp][transport]") {
+    // test inputs
+    auto endpoint = "udp://127.0.0.1:11811";
+    std::string test_msg = "Hello!";
+
+    // create loopback connection
+    UdpTransport udp_transport(endpoint);
+    REQUIRE(udp_transport.connect(endpoint) == 0);
+    REQUIRE(udp_transport.connect("tcp://127.0.0.1:11811") == -1);
+
+    // register receiver handlers for default group and group "group"
+    std::vector<std::string> rx_msgs;
+    std::vector<uintptr_t> rx_addresses;
+    for (auto group : {"", "group"}) {
+        REQUIRE(udp_transport.addReceiver(
+                        [&rx_msgs, &rx_addresses](const void* buffer, size_t len) {
+                            rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+                            rx_addresses.push_back(reinterpret_cast<uintptr_t>(buffer));
+                        },
+                        group) == 0);
+    }
+
+    // send message
+    REQUIRE(udp_transport.transmit(test_msg.c_str(), test_msg.size()) ==
+            static_cast<int>(test_msg.size()));
+    REQUIRE(udp_transport.transmit(test_msg.c_str(), test_msg.size()) ==
+            static_cast<int>(test_msg.size()));
+    REQUIRE(udp_transport.transmit(test_msg.c_str(), test_msg.size(), "group") ==
+            static_cast<int>(test_msg.size()));
+    REQUIRE(udp_transport.transmit(test_msg.c_str(), test_msg.size(), "reject") ==
+            static_cast<int>(test_msg.size()));
+    // exceeds max message size
+    REQUIRE(udp_transport.transmit(std::string(8192, 'x').c_str(), 8192) == -1);
+
+    // receive messages
+    REQUIRE(udp_transport.poll(100) == 0);
+    REQUIRE(udp_transport.poll(0) == EAGAIN);
+    REQUIRE(rx_msgs.size() == 3);
+    for (const auto& rx_msg : rx_msgs) {
+        REQUIRE(test_msg == rx_msg);
+    }
+    // payloads stay aligned whatever the group length
+    for (auto rx_address : rx_addresses) {
+        REQUIRE(rx_address % 8 == 0);
+    }
+
+    // timers run from poll
+    int n_timeouts = 0;
+    REQUIRE(udp_transport.addTimer(1, [&n_timeouts](int) { ++n_timeouts; }) > 0);
+    udp_transport.poll(10);
+    udp_transport.poll(10);
+    REQUIRE(n_timeouts > 0);
+}
+
+TEST_CASE("UDP Transport Recipients", "[udp][transport]") {
+    // test inputs
+    std::vector<std::string> endpoints{
+            "udp://127.0.0.1:11812", "udp://127.0.0.1:11813", "udp://127.0.0.1:11814"};
+    std::string test_msg = "Hello!";
+
+    // create one transport per endpoint, each counting received messages
+    std::vector<std::unique_ptr<UdpTransport>> transports;
+    std::vector<int> rx_counts(endpoints.size(), 0);
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        transports.emplace_back(new UdpTransport(endpoints[i]));
+        REQUIRE(transports.back()->addReceiver(
+                        [&rx_counts, i](const void*, size_t) { ++rx_counts[i]; }) == 0);
+    }
+    const auto poll_all = [&]() {
+        for (auto& transport : transports) {
+            transport->poll(10);
+        }
+    };
+
+    // connect first transport to all endpoints
+    auto& udp_transport = *transports.front();
+    for (const auto& endpoint : endpoints) {
+        REQUIRE(udp_transport.connect(endpoint.c_str()) == 0);
+    }
+
+    // transmit except source
+    REQUIRE(udp_transport.transmitExcept(test_msg.c_str(), test_msg.size(),
+                    endpoints[1].c_str()) == static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{1, 0, 1});
+
+    // transmit to subset, unknown addresses are skipped
+    REQUIRE(udp_transport.transmitTo(test_msg.c_str(), test_msg.size(),
+                    {endpoints[1], "udp://127.0.0.1:11815"}) == static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{1, 1, 1});
+
+    // owned buffers are released after sending
+    int n_released = 0;
+    auto buffer = new char[test_msg.size()];
+    test_msg.copy(buffer, test_msg.size());
+    REQUIRE(udp_transport.transmit(
+                    buffer, test_msg.size(),
+                    [](void* data, void* hint) {
+                        delete[] static_cast<char*>(data);
+                        ++*static_cast<int*>(hint);
+                    },
+                    &n_released) == static_cast<int>(test_msg.size()));
+    REQUIRE(n_released == 1);
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{2, 2, 2});
+
+    // disconnect removes recipient
+    REQUIRE(udp_transport.disconnect(endpoints[2].c_str()) == 0);
+    REQUIRE(udp_transport.disconnect(endpoints[2].c_str()) == -1);
+    REQUIRE(udp_transport.transmit(test_msg.c_str(), test_msg.size()) ==
+            static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{3, 3, 2});
+}
+
+TEST_CASE("UDP Transport Burst", "[udp][transport]") {
+    // a burst larger than one receive batch is drained by a single poll
+    auto endpoint = "udp://127.0.0.1:11816";
+    UdpTransport udp_transport(endpoint, 8);
+    REQUIRE(udp_transport.connect(endpoint) == 0);
+    std::vector<int> rx_msgs;
+    REQUIRE(udp_transport.addReceiver([&rx_msgs](const void* buffer, size_t len) {
+        REQUIRE(len == sizeof(int));
+        rx_msgs.push_back(*static_cast<const int*>(buffer));
+    }) == 0);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(udp_transport.transmit(&i, sizeof(i)) == sizeof(i));
+    }
+    REQUIRE(udp_transport.poll(100) == 0);
+    REQUIRE(rx_msgs.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(rx_msgs[i] == i);
+    }
+}
+
+// each transport sends to itself and n_peers - 1 other sinks, then polls until all arrive
+template <class TransportType>
+static void benchmarkTransport(Catch::Benchmark::Chronometer meter, int base_port) {
+    const size_t n_peers = 4;
+    const size_t n_msgs = 32;
+    const std::string payload(1000, 'x');
+    std::vector<std::unique_ptr<TransportType>> transports;
+    size_t n_received = 0;
+    for (size_t i = 0; i < n_peers; ++i) {
+        auto endpoint = "udp://127.0.0.1:" + std::to_string(base_port + i);
+        transports.emplace_back(new TransportType(endpoint));
+        transports.back()->addReceiver([&n_received](const void*, size_t) { ++n_received; });
+        transports.front()->connect(endpoint.c_str());
+    }
+    meter.measure([&]() {
+        n_received = 0;
+        for (size_t i = 0; i < n_msgs; ++i) {
+            transports.front()->transmit(payload.data(), payload.size());
+        }
+        // bounded so lost datagrams can't stall the benchmark
+        for (int rounds = 0; n_received < n_peers * n_msgs && rounds < 1000; ++rounds) {
+            for (auto& transport : transports) {
+                transport->poll(0);
+            }
+        }
+        return n_received;
+    });
+}
+
+TEST_CASE("UDP Transport Benchmark", "[.][benchmark][transport]") {
+    BENCHMARK_ADVANCED("zmq 4 peers x 32 msgs")(Catch::Benchmark::Chronometer meter) {
+        benchmarkTransport<ZmqTransport>(meter, 11821);
+    };
+    BENCHMARK_ADVANCED("udp 4 peers x 32 msgs")(Catch::Benchmark::Chronometer meter) {
+        benchmarkTransport<UdpTransport>(meter, 11831);
+    };
+}
@@ -1,6 +1,9 @@
 #include <catch2/catch.hpp>
 #include <vsm/zmq_transport.hpp>
 
+#include <atomic>
+#include <memory>
+
 using namespace vsm;
 
 TEST_CASE("ZMQ TCP Req-Rep", "[zmq]") {
@@ -98,3 +101,98 @@ TEST_CASE("ZMQ Transport Loopback", "[zmq][transport]") {
         REQUIRE(test_msg == rx_msg);
     }
 }
+
+TEST_CASE("ZMQ Transport Recipients", "[zmq][transport]") {
+    // test inputs
+    std::vector<std::string> endpoints{
+            "udp://127.0.0.1:11512", "udp://127.0.0.1:11513", "udp://127.0.0.1:11514"};
+    std::string test_msg = "Hello!";
+
+    // create one transport per endpoint, each counting received messages
+    std::vector<std::unique_ptr<ZmqTransport>> transports;
+    std::vector<int> rx_counts(endpoints.size(), 0);
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        transports.emplace_back(new ZmqTransport(endpoints[i]));
+        REQUIRE(transports.back()->addReceiver(
+                        [&rx_counts, i](const void*, size_t) { ++rx_counts[i]; }) == 0);
+    }
+    const auto poll_all = [&]() {
+        for (auto& transport : transports) {
+            transport->poll(10);
+        }
+    };
+
+    // connect first transport to all endpoints
+    auto& zmq_transport = *transports.front();
+    for (const auto& endpoint : endpoints) {
+        REQUIRE(zmq_transport.connect(endpoint.c_str()) == 0);
+    }
+    // connecting twice is a no-op
+    REQUIRE(zmq_transport.connect(endpoints[1].c_str()) == 0);
+
+    // transmit except source
+    REQUIRE(zmq_transport.transmitExcept(test_msg.c_str(), test_msg.size(),
+                    endpoints[1].c_str()) == static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{1, 0, 1});
+
+    // transmit to subset, unknown addresses are skipped
+    REQUIRE(zmq_transport.transmitTo(test_msg.c_str(), test_msg.size(),
+                    {endpoints[1], "udp://127.0.0.1:11515"}) == static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{1, 1, 1});
+
+    // connection state is unchanged
+    REQUIRE(zmq_transport.transmit(test_msg.c_str(), test_msg.size()) ==
+            static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{2, 2, 2});
+
+    // disconnect removes recipient
+    REQUIRE(zmq_transport.disconnect(endpoints[2].c_str()) == 0);
+    REQUIRE(zmq_transport.disconnect(endpoints[2].c_str()) == -1);
+    REQUIRE(zmq_transport.transmit(test_msg.c_str(), test_msg.size()) ==
+            static_cast<int>(test_msg.size()));
+    poll_all();
+    REQUIRE(rx_counts == std::vector<int>{3, 3, 2});
+}
+
+TEST_CASE("ZMQ Transport Zero Copy", "[zmq][transport]") {
+    // test inputs
+    auto endpoint = "udp://127.0.0.1:11516";
+    std::string test_msg = "Hello!";
+
+    // create loopback connection
+    ZmqTransport zmq_transport(endpoint);
+    std::vector<std::string> rx_msgs;
+    REQUIRE(zmq_transport.addReceiver([&rx_msgs](const void* buffer, size_t len) {
+        rx_msgs.emplace_back(static_cast<const char*>(buffer), len);
+    }) == 0);
+
+    // transport owns the buffer until the release callback is called, possibly on the io thread
+    std::atomic<int> n_released{0};
+    const auto transmit_owned = [&](const char* exclude_addr) {
+        auto buffer = new char[test_msg.size()];
+        test_msg.copy(buffer, test_msg.size());
+        return zmq_transport.transmitExcept(
+                buffer, test_msg.size(),
+                [](void* data, void* hint) {
+                    delete[] static_cast<char*>(data);
+                    ++*static_cast<std::atomic<int>*>(hint);
+                },
+                &n_released, exclude_addr);
+    };
+
+    // released even without recipients
+    REQUIRE(transmit_owned(nullptr) == static_cast<int>(test_msg.size()));
+    REQUIRE(n_released == 1);
+
+    // released after sending
+    REQUIRE(zmq_transport.connect(endpoint) == 0);
+    REQUIRE(transmit_owned(nullptr) == static_cast<int>(test_msg.size()));
+    REQUIRE(transmit_owned(endpoint) == static_cast<int>(test_msg.size()));
+    zmq_transport.poll(100);
+    zmq_transport.poll(100);
+    REQUIRE(n_released == 3);
+    REQUIRE(rx_msgs == std::vector<std::string>{test_msg});
+}